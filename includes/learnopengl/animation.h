@@ -8,12 +8,13 @@
 #include <functional>
 #include <learnopengl/animdata.h>
 #include <learnopengl/model_animation.h>
+#include <learnopengl/thread_pool.h>
 
 struct AssimpNodeData
 {
 	glm::mat4 transformation;
 	std::string name;
-	int childrenCount;
+	int childrenCount = 0;
 	std::vector<AssimpNodeData> children;
 };
 
@@ -23,21 +24,62 @@ public:
 	Animation() = default;
 
 	Animation(const std::string& animationPath, Model* model)
+	{
+		if (Import(animationPath))
+			BindBones(*model);
+	}
+
+	// clip from already decoded data (see gltf_model.h); boneInfoMap is the model's, bones without an entry in it
+	// still animate the hierarchy but don't write a final bone matrix
+	Animation(float duration, int ticksPerSecond, AssimpNodeData rootNode, std::vector<Bone> bones, std::map<std::string, BoneInfo> boneInfoMap)
+		: m_Duration(duration), m_TicksPerSecond(ticksPerSecond), m_Bones(std::move(bones)),
+		m_RootNode(std::move(rootNode)), m_BoneInfoMap(std::move(boneInfoMap))
+	{
+	}
+
+	~Animation()
+	{
+	}
+
+	// First half of the constructor: reads the hierarchy and every channel's keys. Touches no model, so clips can
+	// import on several threads at once (one Assimp::Importer each); the bones get their ids in BindBones().
+	// Returns false, leaving the clip empty, when the file has no animation.
+	bool Import(const std::string& animationPath)
 	{
 		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(animationPath, aiProcess_Triangulate);
-		assert(scene && scene->mRootNode);
+		if (!scene || !scene->mRootNode || scene->mNumAnimations == 0)
+		{
+			std::cout << "ERROR::ANIMATION:: could not load " << animationPath << ": " << importer.GetErrorString() << std::endl;
+			return false;
+		}
 		auto animation = scene->mAnimations[0];
 		m_Duration = animation->mDuration;
 		m_TicksPerSecond = animation->mTicksPerSecond;
-		aiMatrix4x4 globalTransformation = scene->mRootNode->mTransformation;
-		globalTransformation = globalTransformation.Inverse();
 		ReadHierarchyData(m_RootNode, scene->mRootNode);
-		ReadMissingBones(animation, *model);
+		ReadChannels(animation);
+		return true;
 	}
 
-	~Animation()
+	// Second half: gives the clip's bones their ids from the model's bone map, adding the bones the model doesn't
+	// have yet. Ids depend only on the order clips are bound in, not on which one finished importing first.
+	void BindBones(Model& model)
 	{
+		auto& boneInfoMap = model.GetBoneInfoMap();//getting m_BoneInfoMap from Model class
+		int& boneCount = model.GetBoneCount(); //getting the m_BoneCounter from Model class
+
+		for (Bone& bone : m_Bones)
+		{
+			const std::string boneName = bone.GetBoneName();
+			if (boneInfoMap.find(boneName) == boneInfoMap.end())
+			{
+				boneInfoMap[boneName].id = boneCount;
+				boneCount++;
+			}
+			bone.SetBoneID(boneInfoMap[boneName].id);
+		}
+
+		m_BoneInfoMap = boneInfoMap;
 	}
 
 	Bone* FindBone(const std::string& name)
@@ -61,30 +103,37 @@ public:
 		return m_BoneInfoMap;
 	}
 
-private:
-	void ReadMissingBones(const aiAnimation* animation, Model& model)
+	// rough heap size of the clip (keys, hierarchy and bone map), for memory budgets
+	size_t GetMemoryBytes() const
 	{
-		int size = animation->mNumChannels;
+		size_t bytes = sizeof(Animation) + m_Bones.capacity() * sizeof(Bone);
+		for (const Bone& bone : m_Bones)
+			bytes += bone.GetKeyBytes();
+		bytes += GetNodeBytes(m_RootNode);
+		// std::map nodes carry about four pointers of bookkeeping each
+		bytes += m_BoneInfoMap.size() * (sizeof(std::pair<const std::string, BoneInfo>) + 4 * sizeof(void*));
+		return bytes;
+	}
 
-		auto& boneInfoMap = model.GetBoneInfoMap();//getting m_BoneInfoMap from Model class
-		int& boneCount = model.GetBoneCount(); //getting the m_BoneCounter from Model class
+private:
+	static size_t GetNodeBytes(const AssimpNodeData& node)
+	{
+		size_t bytes = node.children.capacity() * sizeof(AssimpNodeData);
+		for (const AssimpNodeData& child : node.children)
+			bytes += GetNodeBytes(child);
+		return bytes;
+	}
 
-		//reading channels(bones engaged in an animation and their keyframes)
+	//reading channels(bones engaged in an animation and their keyframes), ids come from BindBones()
+	void ReadChannels(const aiAnimation* animation)
+	{
+		int size = animation->mNumChannels;
+		m_Bones.reserve(size);
 		for (int i = 0; i < size; i++)
 		{
 			auto channel = animation->mChannels[i];
-			std::string boneName = channel->mNodeName.data;
-
-			if (boneInfoMap.find(boneName) == boneInfoMap.end())
-			{
-				boneInfoMap[boneName].id = boneCount;
-				boneCount++;
-			}
-			m_Bones.push_back(Bone(channel->mNodeName.data,
-				boneInfoMap[channel->mNodeName.data].id, channel));
+			m_Bones.push_back(Bone(channel->mNodeName.data, -1, channel));
 		}
-
-		m_BoneInfoMap = boneInfoMap;
 	}
 
 	void ReadHierarchyData(AssimpNodeData& dest, const aiNode* src)
@@ -102,10 +151,29 @@ private:
 			dest.children.push_back(newData);
 		}
 	}
-	float m_Duration;
-	int m_TicksPerSecond;
+	float m_Duration = 0.0f;
+	int m_TicksPerSecond = 0;
 	std::vector<Bone> m_Bones;
 	AssimpNodeData m_RootNode;
 	std::map<std::string, BoneInfo> m_BoneInfoMap;
 };
 
+// Imports the clip files at the same time on pool, one Assimp::Importer per file, then binds them to model in the
+// order of paths, so the bone ids are the same as constructing the clips one after another. Startup costs about the
+// slowest file instead of the sum. Clips that fail to import are left empty.
+inline std::vector<Animation> LoadAnimations(const std::vector<std::string>& paths, Model* model, ThreadPool& pool = ThreadPool::global())
+{
+	std::vector<Animation> clips(paths.size());
+	std::vector<char> imported(paths.size(), 0);
+	pool.parallelFor(paths.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			imported[i] = clips[i].Import(paths[i]);
+	});
+	for (size_t i = 0; i < clips.size(); i++)
+	{
+		if (imported[i])
+			clips[i].BindBones(*model);
+	}
+	return clips;
+}
@@ -0,0 +1,201 @@
+#ifndef ANIMATION_STREAMER_H
+#define ANIMATION_STREAMER_H
+
+#include <learnopengl/animation.h>
+#include <learnopengl/model_animation.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Residency of one clip registered with AnimationStreamer
+struct ClipResidency
+{
+	std::string path;
+	bool resident = false;
+	bool loading = false;
+	bool failed = false;      // the file couldn't be imported, request() won't retry it
+	size_t bytes = 0;         // Animation::GetMemoryBytes() while resident
+	unsigned int loads = 0;   // imports so far, more than one means it was evicted and needed again
+	uint64_t lastNeededFrame = 0;
+};
+
+struct AnimationStreamingStats
+{
+	size_t clips = 0;
+	size_t budgetBytes = 0;
+	size_t residentBytes = 0;
+	unsigned int residentClips = 0;
+	unsigned int loadsInFlight = 0;
+	// last update()
+	unsigned int clipsLoaded = 0;
+	unsigned int clipsEvicted = 0;
+};
+
+// Animation clips that load the first time they are played. add() only registers a file; request() imports it
+// on the pool (Animation::Import) and returns null until update() has bound it to the model's bone map. When the
+// resident clips go over the memory budget, the least recently requested ones are dropped and load again the
+// next time they are needed. Clips still referenced outside the streamer (an Animator playing them) stay.
+//
+// Binding happens in update(), so clips bind in the order they finish loading; ids are per model and stay the
+// same across evictions, since an evicted clip's bones remain in the model's bone map.
+class AnimationStreamer
+{
+public:
+	explicit AnimationStreamer(size_t budgetBytes, ThreadPool& pool = ThreadPool::global())
+		: m_Pool(pool)
+	{
+		m_Stats.budgetBytes = budgetBytes;
+	}
+
+	~AnimationStreamer()
+	{
+		for (Clip& clip : m_Clips)
+		{
+			if (clip.load.valid())
+				clip.load.wait();
+		}
+	}
+
+	AnimationStreamer(const AnimationStreamer&) = delete;
+	AnimationStreamer& operator=(const AnimationStreamer&) = delete;
+
+	// the model clips bind to; loads that finish before it is set wait in update()
+	void setModel(Model* model) { m_Model = model; }
+
+	// registers a clip file without loading it; returns its id, never 0
+	unsigned int add(const std::string& path)
+	{
+		Clip clip;
+		clip.residency.path = path;
+		m_Clips.push_back(std::move(clip));
+		return static_cast<unsigned int>(m_Clips.size());
+	}
+
+	// Marks the clip as needed this frame and returns it when resident; otherwise starts loading it and returns
+	// null. Holding the returned pointer keeps the clip from being evicted.
+	std::shared_ptr<Animation> request(unsigned int id)
+	{
+		if (id == 0 || id > m_Clips.size())
+			return nullptr;
+		Clip& clip = m_Clips[id - 1];
+		clip.residency.lastNeededFrame = m_Frame;
+		if (clip.animation || clip.residency.failed)
+			return clip.animation;
+		if (!clip.load.valid())
+		{
+			const std::string path = clip.residency.path;
+			clip.load = m_Pool.submit([path]() -> std::shared_ptr<Animation>
+			{
+				auto animation = std::make_shared<Animation>();
+				return animation->Import(path) ? animation : nullptr;
+			});
+			clip.residency.loading = true;
+			clip.residency.loads++;
+		}
+		return nullptr;
+	}
+
+	// Once per frame, on the thread that plays the clips: binds finished loads, then evicts the least recently
+	// needed clips nobody holds until the resident ones fit the budget
+	void update()
+	{
+		m_Stats.clipsLoaded = 0;
+		m_Stats.clipsEvicted = 0;
+		finishLoads();
+		evict();
+
+		m_Stats.clips = m_Clips.size();
+		m_Stats.residentBytes = 0;
+		m_Stats.residentClips = 0;
+		m_Stats.loadsInFlight = 0;
+		for (const Clip& clip : m_Clips)
+		{
+			m_Stats.residentBytes += clip.residency.bytes;
+			m_Stats.residentClips += clip.residency.resident ? 1 : 0;
+			m_Stats.loadsInFlight += clip.residency.loading ? 1 : 0;
+		}
+		m_Frame++;
+	}
+
+	void setBudget(size_t budgetBytes) { m_Stats.budgetBytes = budgetBytes; }
+
+	const ClipResidency* getResidency(unsigned int id) const
+	{
+		return id == 0 || id > m_Clips.size() ? nullptr : &m_Clips[id - 1].residency;
+	}
+
+	const AnimationStreamingStats& getStats() const { return m_Stats; }
+
+private:
+	struct Clip
+	{
+		ClipResidency residency;
+		std::shared_ptr<Animation> animation;
+		std::future<std::shared_ptr<Animation>> load;
+	};
+
+	void finishLoads()
+	{
+		for (Clip& clip : m_Clips)
+		{
+			// finished imports wait here until there is a model to bind to
+			if (!m_Model || !clip.load.valid() || clip.load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
+			std::shared_ptr<Animation> animation = clip.load.get();
+			clip.residency.loading = false;
+			if (!animation)
+			{
+				clip.residency.failed = true;
+				continue;
+			}
+			animation->BindBones(*m_Model);
+			clip.residency.bytes = animation->GetMemoryBytes();
+			clip.residency.resident = true;
+			clip.animation = std::move(animation);
+			m_Stats.clipsLoaded++;
+		}
+	}
+
+	void evict()
+	{
+		size_t residentBytes = 0;
+		std::vector<Clip*> candidates;
+		for (Clip& clip : m_Clips)
+		{
+			residentBytes += clip.residency.bytes;
+			// clips needed this frame or held by someone else stay
+			if (clip.animation && clip.residency.lastNeededFrame != m_Frame && clip.animation.use_count() == 1)
+				candidates.push_back(&clip);
+		}
+		if (residentBytes <= m_Stats.budgetBytes)
+			return;
+
+		std::sort(candidates.begin(), candidates.end(), [](const Clip* a, const Clip* b)
+		{
+			return a->residency.lastNeededFrame < b->residency.lastNeededFrame;
+		});
+		for (Clip* clip : candidates)
+		{
+			if (residentBytes <= m_Stats.budgetBytes)
+				break;
+			residentBytes -= clip->residency.bytes;
+			clip->animation.reset();
+			clip->residency.bytes = 0;
+			clip->residency.resident = false;
+			m_Stats.clipsEvicted++;
+		}
+	}
+
+	ThreadPool& m_Pool;
+	Model* m_Model = nullptr;
+	std::vector<Clip> m_Clips; // id - 1
+	AnimationStreamingStats m_Stats;
+	uint64_t m_Frame = 1; // 0 is "never needed"
+};
+#endif
@@ -6,6 +6,7 @@
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
 #include <learnopengl/animation.h>
+#include <learnopengl/animation_streamer.h>
 #include <learnopengl/bone.h>
 
 class Animator
@@ -25,6 +26,17 @@ public:
 	void UpdateAnimation(float dt)
 	{
 		m_DeltaTime = dt;
+		if (m_Streamer)
+		{
+			// switch once the requested clip has loaded, keep the playing one from being evicted
+			if (m_PendingClip)
+			{
+				if (std::shared_ptr<Animation> clip = m_Streamer->request(m_PendingClip))
+					StartClip(m_PendingClip, std::move(clip));
+			}
+			if (m_CurrentClipID)
+				m_Streamer->request(m_CurrentClipID);
+		}
 		if (m_CurrentAnimation)
 		{
 			m_CurrentTime += m_CurrentAnimation->GetTicksPerSecond() * dt;
@@ -37,6 +49,19 @@ public:
 	{
 		m_CurrentAnimation = pAnimation;
 		m_CurrentTime = 0.0f;
+		m_CurrentClip.reset();
+		m_CurrentClipID = 0;
+		m_PendingClip = 0;
+	}
+
+	// Plays a clip of streamer. If it isn't loaded yet this starts the load and the current animation keeps
+	// playing (or the pose holds) until UpdateAnimation() finds it ready.
+	void PlayAnimation(AnimationStreamer& streamer, unsigned int clip)
+	{
+		m_Streamer = &streamer;
+		m_PendingClip = clip;
+		if (std::shared_ptr<Animation> animation = streamer.request(clip))
+			StartClip(clip, std::move(animation));
 	}
 
 	void CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform)
@@ -66,15 +91,29 @@ public:
 			CalculateBoneTransform(&node->children[i], globalTransformation);
 	}
 
-	std::vector<glm::mat4> GetFinalBoneMatrices()
+	const std::vector<glm::mat4>& GetFinalBoneMatrices() const
 	{
 		return m_FinalBoneMatrices;
 	}
 
 private:
+	void StartClip(unsigned int id, std::shared_ptr<Animation> clip)
+	{
+		m_CurrentAnimation = clip.get();
+		m_CurrentTime = 0.0f;
+		m_CurrentClip = std::move(clip);
+		m_CurrentClipID = id;
+		m_PendingClip = 0;
+	}
+
 	std::vector<glm::mat4> m_FinalBoneMatrices;
 	Animation* m_CurrentAnimation;
 	float m_CurrentTime;
 	float m_DeltaTime;
+	// clips played through an AnimationStreamer; holding m_CurrentClip keeps it resident
+	AnimationStreamer* m_Streamer = nullptr;
+	std::shared_ptr<Animation> m_CurrentClip;
+	unsigned int m_CurrentClipID = 0;
+	unsigned int m_PendingClip = 0;
 
 };
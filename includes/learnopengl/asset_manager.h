@@ -0,0 +1,489 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/animation.h>
+#include <learnopengl/model_animation.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum AssetState
+{
+	ASSET_QUEUED,    // waiting for a worker (or for the model a clip belongs to)
+	ASSET_LOADING,   // parsing on a worker
+	ASSET_UPLOADING, // parsed, waiting for AssetManager::update() to create its GL objects (or bind the clip)
+	ASSET_READY,
+	ASSET_FAILED
+};
+
+// Intrusive multi-producer single-consumer queue: push() from any thread without locks, consumeAll() from the
+// one consumer only. Producers CAS onto a stack; the consumer takes the whole stack and reverses it into FIFO order.
+template<typename T>
+class MPSCQueue
+{
+public:
+	MPSCQueue() = default;
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	~MPSCQueue()
+	{
+		consumeAll([](T&) {});
+	}
+
+	void push(T value)
+	{
+		Node* node = new Node{ std::move(value), m_Head.load(std::memory_order_relaxed) };
+		while (!m_Head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	// calls fn on every pushed item in push order (per producer), returns how many there were
+	template<typename F>
+	size_t consumeAll(F&& fn)
+	{
+		Node* node = m_Head.exchange(nullptr, std::memory_order_acquire);
+		Node* reversed = nullptr;
+		while (node)
+		{
+			Node* next = node->next;
+			node->next = reversed;
+			reversed = node;
+			node = next;
+		}
+		size_t count = 0;
+		while (reversed)
+		{
+			Node* next = reversed->next;
+			fn(reversed->value);
+			delete reversed;
+			reversed = next;
+			count++;
+		}
+		return count;
+	}
+
+private:
+	struct Node
+	{
+		T value;
+		Node* next;
+	};
+	std::atomic<Node*> m_Head{ nullptr };
+};
+
+namespace asset_detail
+{
+	struct Slot
+	{
+		std::string path;
+		std::atomic<AssetState> state{ ASSET_QUEUED };
+		std::atomic<int> priority{ 0 };
+		uint64_t sequence = 0;
+		virtual ~Slot() = default;
+	};
+
+	template<typename T>
+	struct TypedSlot : Slot
+	{
+		std::unique_ptr<T> asset;
+	};
+}
+
+// Refers to an asset that may still be loading. Cheap to copy; get() is null until the asset is ready and can be
+// called every frame from the render thread.
+template<typename T>
+class AssetHandle
+{
+public:
+	AssetHandle() = default;
+
+	T* get() const
+	{
+		return m_Slot && m_Slot->state.load(std::memory_order_acquire) == ASSET_READY ? m_Slot->asset.get() : nullptr;
+	}
+
+	AssetState state() const { return m_Slot ? m_Slot->state.load(std::memory_order_acquire) : ASSET_FAILED; }
+	bool isReady() const { return state() == ASSET_READY; }
+	const std::string& path() const { static const std::string none; return m_Slot ? m_Slot->path : none; }
+	explicit operator bool() const { return m_Slot != nullptr; }
+
+private:
+	friend class AssetManager;
+	std::shared_ptr<asset_detail::TypedSlot<T>> m_Slot;
+};
+
+struct AssetManagerStats
+{
+	unsigned int queued = 0;
+	unsigned int loading = 0;
+	unsigned int uploading = 0;
+	unsigned int ready = 0;
+	unsigned int failed = 0;
+	unsigned int uploadsLastUpdate = 0;
+	double uploadMillisecondsLastUpdate = 0.0;
+};
+
+// Loads models, animation clips and shaders in the background. The load* calls return a handle at once; parsing
+// (Assimp, cooked texture caches, shader files) runs on the thread pool, and the GL half of each asset is queued back
+// to the render thread, which creates the GL objects in update() within a time budget. Higher priorities start and
+// upload first; jobs of equal priority go in request order. Requests for a path that is already known return the
+// same handle.
+//
+// Clips import in parallel with each other and with their model (Animation::Import). Each one then binds to the
+// model's bone map in update(), once the model is imported, in the order the clips were requested, so the bone ids
+// don't depend on which file finished first. Binding writes the model, so it stays on the thread that uses it.
+class AssetManager
+{
+public:
+	// maxInFlight == 0 allows one job per pool worker; keeping the rest queued here lets priorities take effect
+	explicit AssetManager(ThreadPool& pool = ThreadPool::global(), unsigned int maxInFlight = 0)
+		: m_Pool(pool), m_MaxInFlight(maxInFlight ? maxInFlight : std::max(1u, pool.size()))
+	{
+	}
+
+	AssetManager(const AssetManager&) = delete;
+	AssetManager& operator=(const AssetManager&) = delete;
+
+	// waits for running jobs, which refer to the manager; queued jobs and pending uploads are dropped
+	~AssetManager()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		for (Job& job : m_Jobs)
+			job.slot->state.store(ASSET_FAILED, std::memory_order_release);
+		m_Jobs.clear();
+		m_Idle.wait(lock, [this] { return m_InFlight == 0; });
+	}
+
+	AssetHandle<Model> loadModel(const std::string& path, int priority = 0, bool gamma = false, TextureStreamer* streamer = nullptr)
+	{
+		AssetHandle<Model> handle;
+		if (findOrCreate("model:" + path, path, priority, handle))
+			return handle;
+
+		auto slot = handle.m_Slot;
+		Job job;
+		job.slot = slot;
+		job.work = [slot, gamma, streamer]()
+		{
+			slot->asset.reset(new Model());
+			slot->asset->gammaCorrection = gamma;
+			slot->asset->textureStreamer = streamer;
+			return slot->asset->Import(slot->path);
+		};
+		job.upload = [slot]()
+		{
+			slot->asset->Upload();
+			return true;
+		};
+		enqueue(std::move(job));
+		return handle;
+	}
+
+	// the clip's bones are added to the model's bone map, as Animation(path, model) does
+	AssetHandle<Animation> loadAnimation(const std::string& path, const AssetHandle<Model>& model, int priority = 0)
+	{
+		AssetHandle<Animation> handle;
+		if (!model || findOrCreate("animation:" + path + '|' + model.path(), path, priority, handle))
+			return handle;
+
+		auto slot = handle.m_Slot;
+		Job job;
+		job.slot = slot;
+		job.work = [slot]()
+		{
+			slot->asset.reset(new Animation());
+			return slot->asset->Import(slot->path);
+		};
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			ClipChain& chain = m_ClipChains[model.m_Slot.get()];
+			chain.model = model.m_Slot;
+			job.clipChain = &chain;
+			job.clipIndex = chain.clips.size();
+			chain.clips.push_back(slot);
+			chain.imported.push_back(CLIP_IMPORTING);
+		}
+		enqueue(std::move(job));
+		return handle;
+	}
+
+	// several clips of one model at once; same as calling loadAnimation for each path in order
+	std::vector<AssetHandle<Animation>> loadAnimations(const std::vector<std::string>& paths, const AssetHandle<Model>& model, int priority = 0)
+	{
+		std::vector<AssetHandle<Animation>> handles;
+		for (const std::string& path : paths)
+			handles.push_back(loadAnimation(path, model, priority));
+		return handles;
+	}
+
+	// files are read on a worker, compiling and linking happen in update()
+	AssetHandle<Shader> loadShader(const std::string& vertexPath, const std::string& fragmentPath, int priority = 0)
+	{
+		AssetHandle<Shader> handle;
+		if (findOrCreate("shader:" + vertexPath + '|' + fragmentPath, vertexPath, priority, handle))
+			return handle;
+
+		auto slot = handle.m_Slot;
+		auto source = std::make_shared<ShaderSource>();
+		Job job;
+		job.slot = slot;
+		job.work = [source, vertexPath, fragmentPath]()
+		{
+			*source = Shader::ReadSource(vertexPath.c_str(), fragmentPath.c_str());
+			return !source->vertex.empty() && !source->fragment.empty();
+		};
+		job.upload = [slot, source]()
+		{
+			slot->asset.reset(new Shader(*source));
+			*source = ShaderSource();
+			return true;
+		};
+		enqueue(std::move(job));
+		return handle;
+	}
+
+	// reorders the asset if it hasn't started (or is waiting for its upload)
+	template<typename T>
+	void setPriority(const AssetHandle<T>& handle, int priority)
+	{
+		if (handle)
+			handle.m_Slot->priority.store(priority, std::memory_order_relaxed);
+	}
+
+	// Render thread, once per frame: creates the GL objects of finished imports, highest priority first, until
+	// budgetMilliseconds is spent. At least one upload runs per call so a slow one can't stall the queue.
+	void update(double budgetMilliseconds = 2.0)
+	{
+		m_Finished.consumeAll([this](PendingUpload& upload) { m_Uploads.push_back(std::move(upload)); });
+		std::stable_sort(m_Uploads.begin(), m_Uploads.end(), [](const PendingUpload& a, const PendingUpload& b)
+		{
+			const int pa = a.slot->priority.load(std::memory_order_relaxed), pb = b.slot->priority.load(std::memory_order_relaxed);
+			return pa != pb ? pa > pb : a.slot->sequence < b.slot->sequence;
+		});
+
+		const auto start = std::chrono::steady_clock::now();
+		size_t done = 0;
+		while (done < m_Uploads.size())
+		{
+			PendingUpload& upload = m_Uploads[done++];
+			const bool ok = upload.upload();
+			upload.slot->state.store(ok ? ASSET_READY : ASSET_FAILED, std::memory_order_release);
+			if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMilliseconds)
+				break;
+		}
+		m_Uploads.erase(m_Uploads.begin(), m_Uploads.begin() + done);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			bindClips();
+		}
+
+		m_Stats.uploadsLastUpdate = static_cast<unsigned int>(done);
+		m_Stats.uploadMillisecondsLastUpdate = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// nothing queued, loading or waiting for update(); render thread only, like update()
+	bool isIdle()
+	{
+		bool busy;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			busy = !m_Jobs.empty() || m_InFlight > 0;
+			for (const auto& entry : m_ClipChains)
+				busy = busy || entry.second.next < entry.second.clips.size();
+		}
+		// a job pushes its upload before it stops counting as in flight
+		m_Finished.consumeAll([this](PendingUpload& upload) { m_Uploads.push_back(std::move(upload)); });
+		return !busy && m_Uploads.empty();
+	}
+
+	// counts by state over every asset requested so far
+	const AssetManagerStats& getStats()
+	{
+		AssetManagerStats& stats = m_Stats;
+		stats.queued = stats.loading = stats.uploading = stats.ready = stats.failed = 0;
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (const auto& entry : m_Slots)
+		{
+			switch (entry.second->state.load(std::memory_order_acquire))
+			{
+			case ASSET_QUEUED: stats.queued++; break;
+			case ASSET_LOADING: stats.loading++; break;
+			case ASSET_UPLOADING: stats.uploading++; break;
+			case ASSET_READY: stats.ready++; break;
+			case ASSET_FAILED: stats.failed++; break;
+			}
+		}
+		return stats;
+	}
+
+private:
+	enum ClipImport { CLIP_IMPORTING, CLIP_IMPORTED, CLIP_FAILED };
+
+	// the clips of one model in request order; clips[0, next) are bound (or failed)
+	struct ClipChain
+	{
+		std::shared_ptr<asset_detail::TypedSlot<Model>> model;
+		std::vector<std::shared_ptr<asset_detail::TypedSlot<Animation>>> clips;
+		std::vector<ClipImport> imported;
+		size_t next = 0;
+	};
+
+	struct Job
+	{
+		std::shared_ptr<asset_detail::Slot> slot;
+		std::function<bool()> work;   // worker thread, false on failure
+		std::function<bool()> upload; // render thread, empty when the asset has no GL objects
+		ClipChain* clipChain = nullptr; // clips become ready through bindClips() in update() instead
+		size_t clipIndex = 0;
+	};
+
+	struct PendingUpload
+	{
+		std::shared_ptr<asset_detail::Slot> slot;
+		std::function<bool()> upload;
+	};
+
+	template<typename T>
+	bool findOrCreate(const std::string& key, const std::string& path, int priority, AssetHandle<T>& handle)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto found = m_Slots.find(key);
+		if (found != m_Slots.end())
+		{
+			handle.m_Slot = std::static_pointer_cast<asset_detail::TypedSlot<T>>(found->second);
+			// a second request can only raise the priority
+			if (priority > handle.m_Slot->priority.load(std::memory_order_relaxed))
+				handle.m_Slot->priority.store(priority, std::memory_order_relaxed);
+			return true;
+		}
+		handle.m_Slot = std::make_shared<asset_detail::TypedSlot<T>>();
+		handle.m_Slot->path = path;
+		handle.m_Slot->priority.store(priority, std::memory_order_relaxed);
+		handle.m_Slot->sequence = m_NextSequence++;
+		m_Slots[key] = handle.m_Slot;
+		return false;
+	}
+
+	void enqueue(Job job)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Jobs.push_back(std::move(job));
+		dispatch();
+	}
+
+	// starts the highest priority jobs while there is room; called with m_Mutex held
+	void dispatch()
+	{
+		while (m_InFlight < m_MaxInFlight && !m_Jobs.empty())
+		{
+			auto best = m_Jobs.begin();
+			for (auto it = m_Jobs.begin() + 1; it != m_Jobs.end(); ++it)
+			{
+				if (higherPriority(*it->slot, *best->slot))
+					best = it;
+			}
+
+			auto job = std::make_shared<Job>(std::move(*best));
+			m_Jobs.erase(best);
+			job->slot->state.store(ASSET_LOADING, std::memory_order_release);
+			m_InFlight++;
+			m_Pool.submit([this, job]() { run(*job); });
+		}
+	}
+
+	static bool higherPriority(const asset_detail::Slot& a, const asset_detail::Slot& b)
+	{
+		const int pa = a.priority.load(std::memory_order_relaxed), pb = b.priority.load(std::memory_order_relaxed);
+		return pa != pb ? pa > pb : a.sequence < b.sequence;
+	}
+
+	// Binds every clip whose predecessors in its chain are done, once the chain's model is imported. Render thread
+	// only: BindBones() writes the model's bone map, which Upload(), drawing and other clips use on that thread too.
+	// A few map lookups per bone, cheap enough to do under the lock; called with m_Mutex held.
+	void bindClips()
+	{
+		for (auto& entry : m_ClipChains)
+		{
+			ClipChain& chain = entry.second;
+			const AssetState modelState = chain.model->state.load(std::memory_order_acquire);
+			const bool modelFailed = modelState == ASSET_FAILED;
+			if (!modelFailed && modelState != ASSET_UPLOADING && modelState != ASSET_READY)
+				continue;
+			for (; chain.next < chain.clips.size() && chain.imported[chain.next] != CLIP_IMPORTING; chain.next++)
+			{
+				auto& clip = chain.clips[chain.next];
+				if (modelFailed || chain.imported[chain.next] == CLIP_FAILED)
+				{
+					clip->state.store(ASSET_FAILED, std::memory_order_release);
+					continue;
+				}
+				clip->asset->BindBones(*chain.model->asset);
+				clip->state.store(ASSET_READY, std::memory_order_release);
+			}
+		}
+	}
+
+	void run(Job& job)
+	{
+		const bool ok = job.work();
+		// clips wait for update() to bind them
+		if (job.clipChain)
+		{
+			if (ok)
+				job.slot->state.store(ASSET_UPLOADING, std::memory_order_release);
+		}
+		else
+		{
+			if (!ok)
+				job.slot->state.store(ASSET_FAILED, std::memory_order_release);
+			else if (job.upload)
+			{
+				job.slot->state.store(ASSET_UPLOADING, std::memory_order_release);
+				m_Finished.push({ job.slot, std::move(job.upload) });
+			}
+			else
+				job.slot->state.store(ASSET_READY, std::memory_order_release);
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (job.clipChain)
+			job.clipChain->imported[job.clipIndex] = ok ? CLIP_IMPORTED : CLIP_FAILED;
+		m_InFlight--;
+		dispatch();
+		if (m_InFlight == 0)
+			m_Idle.notify_all();
+	}
+
+	ThreadPool& m_Pool;
+	const unsigned int m_MaxInFlight;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Idle;
+	std::vector<Job> m_Jobs; // not started yet
+	unsigned int m_InFlight = 0;
+	std::map<std::string, std::shared_ptr<asset_detail::Slot>> m_Slots;
+	std::map<const asset_detail::Slot*, ClipChain> m_ClipChains; // keyed by model, std::map keeps the chains in place
+	uint64_t m_NextSequence = 0;
+
+	MPSCQueue<PendingUpload> m_Finished; // workers -> render thread
+	std::vector<PendingUpload> m_Uploads; // render thread only
+	AssetManagerStats m_Stats;
+};
+#endif
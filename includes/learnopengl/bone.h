@@ -72,6 +72,21 @@ public:
 		}
 	}
 	
+	// keys already decoded, e.g. by the glTF loader; every list needs at least one key
+	Bone(const std::string& name, int ID, std::vector<KeyPosition> positions, std::vector<KeyRotation> rotations, std::vector<KeyScale> scales)
+		:
+		m_Positions(std::move(positions)),
+		m_Rotations(std::move(rotations)),
+		m_Scales(std::move(scales)),
+		m_LocalTransform(1.0f),
+		m_Name(name),
+		m_ID(ID)
+	{
+		m_NumPositions = static_cast<int>(m_Positions.size());
+		m_NumRotations = static_cast<int>(m_Rotations.size());
+		m_NumScalings = static_cast<int>(m_Scales.size());
+	}
+	
 	void Update(float animationTime)
 	{
 		glm::mat4 translation = InterpolatePosition(animationTime);
@@ -82,6 +97,13 @@ public:
 	glm::mat4 GetLocalTransform() { return m_LocalTransform; }
 	std::string GetBoneName() const { return m_Name; }
 	int GetBoneID() { return m_ID; }
+	// for clips imported before their model's bone map is known (Animation::BindBones)
+	void SetBoneID(int id) { m_ID = id; }
+	// heap held by the keys, for memory budgets
+	size_t GetKeyBytes() const
+	{
+		return m_Positions.capacity() * sizeof(KeyPosition) + m_Rotations.capacity() * sizeof(KeyRotation) + m_Scales.capacity() * sizeof(KeyScale);
+	}
 	
 
 
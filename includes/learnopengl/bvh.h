@@ -0,0 +1,542 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum_culler.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+struct BVHBounds
+{
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+	BVHBounds() = default;
+	BVHBounds(const glm::vec3& inMin, const glm::vec3& inMax) : min(inMin), max(inMax) {}
+
+	static BVHBounds fromCenterExtents(const glm::vec3& center, const glm::vec3& extents)
+	{
+		return BVHBounds(center - extents, center + extents);
+	}
+
+	static BVHBounds merge(const BVHBounds& a, const BVHBounds& b)
+	{
+		return BVHBounds(glm::min(a.min, b.min), glm::max(a.max, b.max));
+	}
+
+	void grow(const BVHBounds& other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	bool contains(const BVHBounds& other) const
+	{
+		return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+	}
+
+	bool overlaps(const BVHBounds& other) const
+	{
+		return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+	}
+
+	float surfaceArea() const
+	{
+		const glm::vec3 d = glm::max(max - min, glm::vec3(0.0f));
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	glm::vec3 extents() const { return (max - min) * 0.5f; }
+};
+
+// Dynamic AABB tree (bounding volume hierarchy) over arbitrary objects, usually entities.
+// Leaves store a fattened box so small movements don't touch the tree at all; larger ones refit or reinsert the leaf.
+// Inserts pick the sibling with the lowest surface-area cost and rotations keep the tree balanced.
+// rebuild() does a full binned-SAH build, best for static content.
+class BVH
+{
+public:
+	static const int NULL_NODE = -1;
+
+	// margin added on every side of leaf boxes
+	explicit BVH(float fatMargin = 0.1f) : m_Margin(fatMargin) {}
+
+	// returns a proxy id, stable until destroyProxy
+	int createProxy(const BVHBounds& bounds, void* userData)
+	{
+		const int leaf = allocateNode();
+		m_Nodes[leaf].bounds = fatten(bounds);
+		m_Nodes[leaf].userData = userData;
+		m_Nodes[leaf].height = 0;
+		insertLeaf(leaf);
+		m_LeafCount++;
+		return leaf;
+	}
+
+	void destroyProxy(int proxy)
+	{
+		removeLeaf(proxy);
+		freeNode(proxy);
+		m_LeafCount--;
+	}
+
+	// reinserts when the object left its fat box; returns true if the tree changed
+	bool moveProxy(int proxy, const BVHBounds& bounds)
+	{
+		if (m_Nodes[proxy].bounds.contains(bounds))
+			return false;
+
+		removeLeaf(proxy);
+		m_Nodes[proxy].bounds = fatten(bounds);
+		insertLeaf(proxy);
+		return true;
+	}
+
+	// cheaper than moveProxy for small moves: resizes the leaf in place and refits its ancestors.
+	// Tree quality degrades slowly, so rebuild() or moveProxy now and then.
+	void refitProxy(int proxy, const BVHBounds& bounds)
+	{
+		if (m_Nodes[proxy].bounds.contains(bounds))
+			return;
+		m_Nodes[proxy].bounds = fatten(bounds);
+		for (int index = m_Nodes[proxy].parent; index != NULL_NODE; index = m_Nodes[index].parent)
+		{
+			Node& node = m_Nodes[index];
+			node.bounds = BVHBounds::merge(m_Nodes[node.left].bounds, m_Nodes[node.right].bounds);
+		}
+	}
+
+	void* getUserData(int proxy) const { return m_Nodes[proxy].userData; }
+	const BVHBounds& getFatBounds(int proxy) const { return m_Nodes[proxy].bounds; }
+	int size() const { return m_LeafCount; }
+	int height() const { return m_Root == NULL_NODE ? 0 : m_Nodes[m_Root].height; }
+
+	// top-down SAH rebuild over all current leaves; proxy ids stay valid
+	void rebuild()
+	{
+		std::vector<int> leaves;
+		leaves.reserve(m_LeafCount);
+		for (int i = 0; i < static_cast<int>(m_Nodes.size()); i++)
+		{
+			if (m_Nodes[i].height == 0)
+				leaves.push_back(i);
+			else if (m_Nodes[i].height > 0)
+				freeNode(i);
+		}
+		if (leaves.empty())
+		{
+			m_Root = NULL_NODE;
+			return;
+		}
+		m_Root = buildSAH(leaves.data(), static_cast<int>(leaves.size()));
+		m_Nodes[m_Root].parent = NULL_NODE;
+	}
+
+	// calls visit for every leaf touching the frustum. Subtrees completely inside are accepted without further plane tests.
+	void queryFrustum(const FrustumPlanes& frustum, const std::function<void(void*)>& visit) const
+	{
+		if (m_Root != NULL_NODE)
+			queryFrustum(frustum, m_Root, 0x3F, visit);
+	}
+
+	void queryAABB(const BVHBounds& bounds, const std::function<void(void*)>& visit) const
+	{
+		if (m_Root == NULL_NODE)
+			return;
+		std::vector<int>& stack = m_Stack;
+		stack.clear();
+		stack.push_back(m_Root);
+		while (!stack.empty())
+		{
+			const Node& node = m_Nodes[stack.back()];
+			stack.pop_back();
+			if (!node.bounds.overlaps(bounds))
+				continue;
+			if (node.isLeaf())
+				visit(node.userData);
+			else
+			{
+				stack.push_back(node.left);
+				stack.push_back(node.right);
+			}
+		}
+	}
+
+	// visit returns the new maximum distance: the hit distance to keep only closer hits, maxDistance to keep going,
+	// or 0 to stop. Distances are in units of direction's length.
+	void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+		const std::function<float(void*, float entryDistance)>& visit) const
+	{
+		if (m_Root == NULL_NODE)
+			return;
+		const glm::vec3 invDirection = 1.0f / direction;
+		std::vector<int>& stack = m_Stack;
+		stack.clear();
+		stack.push_back(m_Root);
+		while (!stack.empty())
+		{
+			const Node& node = m_Nodes[stack.back()];
+			stack.pop_back();
+			float entry;
+			if (!rayHitsBounds(origin, invDirection, node.bounds, maxDistance, entry))
+				continue;
+			if (node.isLeaf())
+			{
+				maxDistance = visit(node.userData, entry);
+				if (maxDistance <= 0.0f)
+					return;
+			}
+			else
+			{
+				stack.push_back(node.left);
+				stack.push_back(node.right);
+			}
+		}
+	}
+
+private:
+	struct Node
+	{
+		BVHBounds bounds;
+		void* userData = nullptr;
+		int parent = NULL_NODE;
+		int left = NULL_NODE;
+		int right = NULL_NODE;
+		int height = -1; // 0 leaf, -1 free
+		int nextFree = NULL_NODE;
+
+		bool isLeaf() const { return height == 0; }
+	};
+
+	BVHBounds fatten(const BVHBounds& bounds) const
+	{
+		return BVHBounds(bounds.min - glm::vec3(m_Margin), bounds.max + glm::vec3(m_Margin));
+	}
+
+	int allocateNode()
+	{
+		if (m_FreeList == NULL_NODE)
+		{
+			m_Nodes.emplace_back();
+			return static_cast<int>(m_Nodes.size()) - 1;
+		}
+		const int index = m_FreeList;
+		m_FreeList = m_Nodes[index].nextFree;
+		m_Nodes[index] = Node();
+		return index;
+	}
+
+	void freeNode(int index)
+	{
+		m_Nodes[index].height = -1;
+		m_Nodes[index].nextFree = m_FreeList;
+		m_FreeList = index;
+	}
+
+	void insertLeaf(int leaf)
+	{
+		if (m_Root == NULL_NODE)
+		{
+			m_Root = leaf;
+			m_Nodes[leaf].parent = NULL_NODE;
+			return;
+		}
+
+		// descend towards the sibling with the lowest SAH cost increase
+		const BVHBounds leafBounds = m_Nodes[leaf].bounds;
+		int index = m_Root;
+		while (!m_Nodes[index].isLeaf())
+		{
+			const Node& node = m_Nodes[index];
+			const float area = node.bounds.surfaceArea();
+			const float combinedArea = BVHBounds::merge(node.bounds, leafBounds).surfaceArea();
+
+			// cost of making a new parent for this node and the leaf, and the inherited cost pushed to the children
+			const float cost = 2.0f * combinedArea;
+			const float inheritance = 2.0f * (combinedArea - area);
+
+			const float costLeft = childCost(node.left, leafBounds) + inheritance;
+			const float costRight = childCost(node.right, leafBounds) + inheritance;
+
+			if (cost < costLeft && cost < costRight)
+				break;
+			index = costLeft < costRight ? node.left : node.right;
+		}
+
+		const int sibling = index;
+		const int oldParent = m_Nodes[sibling].parent;
+		const int newParent = allocateNode();
+		m_Nodes[newParent].parent = oldParent;
+		m_Nodes[newParent].bounds = BVHBounds::merge(leafBounds, m_Nodes[sibling].bounds);
+		m_Nodes[newParent].height = m_Nodes[sibling].height + 1;
+		m_Nodes[newParent].left = sibling;
+		m_Nodes[newParent].right = leaf;
+		m_Nodes[sibling].parent = newParent;
+		m_Nodes[leaf].parent = newParent;
+
+		if (oldParent == NULL_NODE)
+			m_Root = newParent;
+		else if (m_Nodes[oldParent].left == sibling)
+			m_Nodes[oldParent].left = newParent;
+		else
+			m_Nodes[oldParent].right = newParent;
+
+		refitAncestors(newParent);
+	}
+
+	float childCost(int child, const BVHBounds& leafBounds) const
+	{
+		const Node& node = m_Nodes[child];
+		const float combined = BVHBounds::merge(node.bounds, leafBounds).surfaceArea();
+		return node.isLeaf() ? combined : combined - node.bounds.surfaceArea();
+	}
+
+	void removeLeaf(int leaf)
+	{
+		if (leaf == m_Root)
+		{
+			m_Root = NULL_NODE;
+			return;
+		}
+
+		const int parent = m_Nodes[leaf].parent;
+		const int grandParent = m_Nodes[parent].parent;
+		const int sibling = m_Nodes[parent].left == leaf ? m_Nodes[parent].right : m_Nodes[parent].left;
+
+		if (grandParent == NULL_NODE)
+		{
+			m_Root = sibling;
+			m_Nodes[sibling].parent = NULL_NODE;
+		}
+		else
+		{
+			if (m_Nodes[grandParent].left == parent)
+				m_Nodes[grandParent].left = sibling;
+			else
+				m_Nodes[grandParent].right = sibling;
+			m_Nodes[sibling].parent = grandParent;
+			refitAncestors(grandParent);
+		}
+		freeNode(parent);
+		m_Nodes[leaf].parent = NULL_NODE;
+	}
+
+	void refitAncestors(int index)
+	{
+		while (index != NULL_NODE)
+		{
+			index = balance(index);
+			Node& node = m_Nodes[index];
+			node.height = 1 + std::max(m_Nodes[node.left].height, m_Nodes[node.right].height);
+			node.bounds = BVHBounds::merge(m_Nodes[node.left].bounds, m_Nodes[node.right].bounds);
+			index = node.parent;
+		}
+	}
+
+	// AVL-style rotation when one child is two levels taller than the other; returns the subtree's new root
+	int balance(int a)
+	{
+		Node& A = m_Nodes[a];
+		if (A.isLeaf() || A.height < 2)
+			return a;
+
+		const int b = A.left;
+		const int c = A.right;
+		const int heightDiff = m_Nodes[c].height - m_Nodes[b].height;
+		if (heightDiff > 1)
+			return rotateUp(a, c, true);
+		if (heightDiff < -1)
+			return rotateUp(a, b, false);
+		return a;
+	}
+
+	// promotes a's taller child `up` above it
+	int rotateUp(int a, int up, bool upIsRight)
+	{
+		Node& A = m_Nodes[a];
+		Node& U = m_Nodes[up];
+		const int f = U.left;
+		const int g = U.right;
+
+		U.left = a;
+		U.parent = A.parent;
+		A.parent = up;
+
+		if (U.parent == NULL_NODE)
+			m_Root = up;
+		else if (m_Nodes[U.parent].left == a)
+			m_Nodes[U.parent].left = up;
+		else
+			m_Nodes[U.parent].right = up;
+
+		// keep the taller grandchild under up, hand the shorter one to a
+		const bool fTaller = m_Nodes[f].height > m_Nodes[g].height;
+		const int keep = fTaller ? f : g;
+		const int give = fTaller ? g : f;
+		U.right = keep;
+		if (upIsRight)
+			A.right = give;
+		else
+			A.left = give;
+		m_Nodes[give].parent = a;
+
+		A.bounds = BVHBounds::merge(m_Nodes[A.left].bounds, m_Nodes[A.right].bounds);
+		A.height = 1 + std::max(m_Nodes[A.left].height, m_Nodes[A.right].height);
+		U.bounds = BVHBounds::merge(A.bounds, m_Nodes[keep].bounds);
+		U.height = 1 + std::max(A.height, m_Nodes[keep].height);
+		return up;
+	}
+
+	// binned SAH over the leaves' centers, 12 bins per axis
+	int buildSAH(int* leaves, int count)
+	{
+		if (count == 1)
+			return leaves[0];
+
+		BVHBounds bounds, centroidBounds;
+		for (int i = 0; i < count; i++)
+		{
+			bounds.grow(m_Nodes[leaves[i]].bounds);
+			const glm::vec3 c = m_Nodes[leaves[i]].bounds.center();
+			centroidBounds.grow(BVHBounds(c, c));
+		}
+
+		const int BINS = 12;
+		int bestAxis = -1, bestSplit = 0;
+		float bestCost = std::numeric_limits<float>::max();
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float lo = centroidBounds.min[axis];
+			const float span = centroidBounds.max[axis] - lo;
+			if (span <= 0.0f)
+				continue;
+
+			BVHBounds binBounds[BINS];
+			int binCount[BINS] = {};
+			for (int i = 0; i < count; i++)
+			{
+				const int bin = binOf(m_Nodes[leaves[i]].bounds.center()[axis], lo, span, BINS);
+				binCount[bin]++;
+				binBounds[bin].grow(m_Nodes[leaves[i]].bounds);
+			}
+
+			// sweep from the right, then evaluate each split from the left
+			float rightArea[BINS];
+			int rightCount[BINS];
+			BVHBounds accumulated;
+			int accumulatedCount = 0;
+			for (int bin = BINS - 1; bin > 0; bin--)
+			{
+				accumulated.grow(binBounds[bin]);
+				accumulatedCount += binCount[bin];
+				rightArea[bin] = accumulated.surfaceArea();
+				rightCount[bin] = accumulatedCount;
+			}
+			accumulated = BVHBounds();
+			accumulatedCount = 0;
+			for (int split = 1; split < BINS; split++)
+			{
+				accumulated.grow(binBounds[split - 1]);
+				accumulatedCount += binCount[split - 1];
+				if (accumulatedCount == 0 || rightCount[split] == 0)
+					continue;
+				const float cost = accumulated.surfaceArea() * accumulatedCount + rightArea[split] * rightCount[split];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		int mid;
+		if (bestAxis < 0)
+		{
+			// every center coincides, split in the middle
+			mid = count / 2;
+		}
+		else
+		{
+			const float lo = centroidBounds.min[bestAxis];
+			const float span = centroidBounds.max[bestAxis] - lo;
+			int* split = std::partition(leaves, leaves + count, [&](int leaf)
+			{
+				return binOf(m_Nodes[leaf].bounds.center()[bestAxis], lo, span, BINS) < bestSplit;
+			});
+			mid = static_cast<int>(split - leaves);
+		}
+
+		const int left = buildSAH(leaves, mid);
+		const int right = buildSAH(leaves + mid, count - mid);
+		const int node = allocateNode();
+		m_Nodes[node].left = left;
+		m_Nodes[node].right = right;
+		m_Nodes[node].bounds = BVHBounds::merge(m_Nodes[left].bounds, m_Nodes[right].bounds);
+		m_Nodes[node].height = 1 + std::max(m_Nodes[left].height, m_Nodes[right].height);
+		m_Nodes[left].parent = node;
+		m_Nodes[right].parent = node;
+		return node;
+	}
+
+	static int binOf(float value, float lo, float span, int bins)
+	{
+		return std::min(bins - 1, static_cast<int>((value - lo) / span * bins));
+	}
+
+	// planeMask has a bit set for every plane the parent was not completely inside of
+	void queryFrustum(const FrustumPlanes& frustum, int index, unsigned int planeMask, const std::function<void(void*)>& visit) const
+	{
+		const Node& node = m_Nodes[index];
+		if (planeMask)
+		{
+			const glm::vec3 center = node.bounds.center();
+			const glm::vec3 extents = node.bounds.extents();
+			for (int i = 0; i < 6; i++)
+			{
+				if (!(planeMask & (1u << i)))
+					continue;
+				const glm::vec4& plane = frustum.planes[i];
+				const float d = glm::dot(glm::vec3(plane), center) + plane.w;
+				const float r = glm::dot(glm::abs(glm::vec3(plane)), extents);
+				if (d + r < 0.0f)
+					return;
+				if (d - r >= 0.0f)
+					planeMask &= ~(1u << i);
+			}
+		}
+
+		if (node.isLeaf())
+		{
+			visit(node.userData);
+			return;
+		}
+		queryFrustum(frustum, node.left, planeMask, visit);
+		queryFrustum(frustum, node.right, planeMask, visit);
+	}
+
+	static bool rayHitsBounds(const glm::vec3& origin, const glm::vec3& invDirection, const BVHBounds& bounds, float maxDistance, float& entry)
+	{
+		const glm::vec3 t0 = (bounds.min - origin) * invDirection;
+		const glm::vec3 t1 = (bounds.max - origin) * invDirection;
+		const glm::vec3 tNear = glm::min(t0, t1);
+		const glm::vec3 tFar = glm::max(t0, t1);
+		entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+		return entry <= exit;
+	}
+
+	std::vector<Node> m_Nodes;
+	int m_Root = NULL_NODE;
+	int m_FreeList = NULL_NODE;
+	int m_LeafCount = 0;
+	float m_Margin;
+	mutable std::vector<int> m_Stack;
+};
+#endif
@@ -0,0 +1,553 @@
+#ifndef DXT_ENCODER_H
+#define DXT_ENCODER_H
+
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// SSE2 for the integer unpacking of texels
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define DXT_ENCODER_USE_SSE 1
+#endif
+
+enum DXTFormat
+{
+	DXT_FORMAT_DXT1, // RGB, 8 bytes per block
+	DXT_FORMAT_DXT5, // RGB + BC4 alpha, 16 bytes per block
+	DXT_FORMAT_BC5   // two BC4 blocks for red and green, 16 bytes per block
+};
+
+struct DXTEncodeStats
+{
+	size_t pixels = 0;
+	double milliseconds = 0.0;
+
+	double megapixelsPerSecond() const { return milliseconds > 0.0 ? pixels / (milliseconds * 1000.0) : 0.0; }
+};
+
+inline size_t DXTBlockSize(DXTFormat format)
+{
+	return format == DXT_FORMAT_DXT1 ? 8 : 16;
+}
+
+inline size_t DXTImageSize(DXTFormat format, int width, int height)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * DXTBlockSize(format);
+}
+
+namespace dxt_detail
+{
+	// one 4x4 block, channels split so 4 texels go through each SSE operation
+	struct alignas(16) ColorBlock
+	{
+		float r[16];
+		float g[16];
+		float b[16];
+	};
+
+	// color is in [0, 255]
+	inline uint16_t to565(const float color[3])
+	{
+		const int r = static_cast<int>(color[0] * (31.0f / 255.0f) + 0.5f);
+		const int g = static_cast<int>(color[1] * (63.0f / 255.0f) + 0.5f);
+		const int b = static_cast<int>(color[2] * (31.0f / 255.0f) + 0.5f);
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	}
+
+	// bit replication, as the hardware expands it
+	inline void from565(uint16_t value, int color[3])
+	{
+		const int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+		color[0] = r << 3 | r >> 2;
+		color[1] = g << 2 | g >> 4;
+		color[2] = b << 3 | b >> 2;
+	}
+
+	// the four colours of a 4-colour block: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+	inline void palette(uint16_t c0, uint16_t c1, float out[4][3])
+	{
+		int a[3], b[3];
+		from565(c0, a);
+		from565(c1, b);
+		for (int c = 0; c < 3; c++)
+		{
+			out[0][c] = static_cast<float>(a[c]);
+			out[1][c] = static_cast<float>(b[c]);
+			out[2][c] = static_cast<float>((2 * a[c] + b[c]) / 3);
+			out[3][c] = static_cast<float>((a[c] + 2 * b[c]) / 3);
+		}
+	}
+
+	// nearest palette entry per texel, returns the summed squared error
+	inline float fitIndices(const ColorBlock& block, const float colors[4][3], unsigned char indices[16])
+	{
+#if defined(DXT_ENCODER_USE_SSE)
+		float error = 0.0f;
+		for (int i = 0; i < 16; i += 4)
+		{
+			const __m128 r = _mm_load_ps(block.r + i), g = _mm_load_ps(block.g + i), b = _mm_load_ps(block.b + i);
+			__m128 best = _mm_set1_ps(3.4e38f), bestIndex = _mm_setzero_ps();
+			for (int k = 0; k < 4; k++)
+			{
+				const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(colors[k][0]));
+				const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(colors[k][1]));
+				const __m128 db = _mm_sub_ps(b, _mm_set1_ps(colors[k][2]));
+				const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+				const __m128 closer = _mm_cmplt_ps(d, best);
+				best = _mm_min_ps(d, best);
+				bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(k))), _mm_andnot_ps(closer, bestIndex));
+			}
+			alignas(16) float bestErrors[4], bestIndices[4];
+			_mm_store_ps(bestErrors, best);
+			_mm_store_ps(bestIndices, bestIndex);
+			for (int j = 0; j < 4; j++)
+			{
+				error += bestErrors[j];
+				indices[i + j] = static_cast<unsigned char>(bestIndices[j]);
+			}
+		}
+		return error;
+#else
+		float error = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float best = 3.4e38f;
+			for (int k = 0; k < 4; k++)
+			{
+				const float dr = block.r[i] - colors[k][0], dg = block.g[i] - colors[k][1], db = block.b[i] - colors[k][2];
+				const float d = dr * dr + dg * dg + db * db;
+				if (d < best)
+				{
+					best = d;
+					indices[i] = static_cast<unsigned char>(k);
+				}
+			}
+			error += best;
+		}
+		return error;
+#endif
+	}
+
+	// mean, then the principal axis of the covariance and the texels' extent along it
+	inline void principalAxis(const ColorBlock& block, float mean[3], float axis[3], float& minProjection, float& maxProjection)
+	{
+		float covariance[6]; // rr rg rb gg gb bb
+#if defined(DXT_ENCODER_USE_SSE)
+		__m128 sumR = _mm_setzero_ps(), sumG = _mm_setzero_ps(), sumB = _mm_setzero_ps();
+		for (int i = 0; i < 16; i += 4)
+		{
+			sumR = _mm_add_ps(sumR, _mm_load_ps(block.r + i));
+			sumG = _mm_add_ps(sumG, _mm_load_ps(block.g + i));
+			sumB = _mm_add_ps(sumB, _mm_load_ps(block.b + i));
+		}
+		alignas(16) float lanes[4];
+		const __m128 sums[3] = { sumR, sumG, sumB };
+		for (int c = 0; c < 3; c++)
+		{
+			_mm_store_ps(lanes, sums[c]);
+			mean[c] = (lanes[0] + lanes[1] + lanes[2] + lanes[3]) / 16.0f;
+		}
+
+		const __m128 meanR = _mm_set1_ps(mean[0]), meanG = _mm_set1_ps(mean[1]), meanB = _mm_set1_ps(mean[2]);
+		__m128 products[6] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+		for (int i = 0; i < 16; i += 4)
+		{
+			const __m128 r = _mm_sub_ps(_mm_load_ps(block.r + i), meanR);
+			const __m128 g = _mm_sub_ps(_mm_load_ps(block.g + i), meanG);
+			const __m128 b = _mm_sub_ps(_mm_load_ps(block.b + i), meanB);
+			products[0] = _mm_add_ps(products[0], _mm_mul_ps(r, r));
+			products[1] = _mm_add_ps(products[1], _mm_mul_ps(r, g));
+			products[2] = _mm_add_ps(products[2], _mm_mul_ps(r, b));
+			products[3] = _mm_add_ps(products[3], _mm_mul_ps(g, g));
+			products[4] = _mm_add_ps(products[4], _mm_mul_ps(g, b));
+			products[5] = _mm_add_ps(products[5], _mm_mul_ps(b, b));
+		}
+		for (int k = 0; k < 6; k++)
+		{
+			_mm_store_ps(lanes, products[k]);
+			covariance[k] = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		}
+#else
+		for (int c = 0; c < 3; c++)
+			mean[c] = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			mean[0] += block.r[i] / 16.0f;
+			mean[1] += block.g[i] / 16.0f;
+			mean[2] += block.b[i] / 16.0f;
+		}
+		std::fill(covariance, covariance + 6, 0.0f);
+		for (int i = 0; i < 16; i++)
+		{
+			const float r = block.r[i] - mean[0], g = block.g[i] - mean[1], b = block.b[i] - mean[2];
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+#endif
+
+		// power iteration, started on the axis with the largest variance
+		axis[0] = covariance[0];
+		axis[1] = covariance[3];
+		axis[2] = covariance[5];
+		const int largest = axis[0] >= axis[1] && axis[0] >= axis[2] ? 0 : axis[1] >= axis[2] ? 1 : 2;
+		axis[0] = axis[1] = axis[2] = 0.0f;
+		axis[largest] = 1.0f;
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+			const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+			const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+			const float length = std::max(std::abs(x), std::max(std::abs(y), std::abs(z)));
+			if (length < 1e-6f)
+				break;
+			axis[0] = x / length;
+			axis[1] = y / length;
+			axis[2] = z / length;
+		}
+		const float norm = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		for (int c = 0; c < 3; c++)
+			axis[c] /= norm;
+
+#if defined(DXT_ENCODER_USE_SSE)
+		const __m128 axisR = _mm_set1_ps(axis[0]), axisG = _mm_set1_ps(axis[1]), axisB = _mm_set1_ps(axis[2]);
+		__m128 low = _mm_set1_ps(3.4e38f), high = _mm_set1_ps(-3.4e38f);
+		for (int i = 0; i < 16; i += 4)
+		{
+			const __m128 projection = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.r + i), meanR), axisR),
+				_mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.g + i), meanG), axisG)),
+				_mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.b + i), meanB), axisB));
+			low = _mm_min_ps(low, projection);
+			high = _mm_max_ps(high, projection);
+		}
+		_mm_store_ps(lanes, low);
+		minProjection = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+		_mm_store_ps(lanes, high);
+		maxProjection = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#else
+		minProjection = 3.4e38f;
+		maxProjection = -3.4e38f;
+		for (int i = 0; i < 16; i++)
+		{
+			const float projection = (block.r[i] - mean[0]) * axis[0] + (block.g[i] - mean[1]) * axis[1] + (block.b[i] - mean[2]) * axis[2];
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+#endif
+	}
+
+	// quantises both endpoints, keeps c0 > c1 (4-colour mode) and fits the indices
+	inline float evaluateEndpoints(const ColorBlock& block, const float end0[3], const float end1[3], uint16_t& c0, uint16_t& c1, unsigned char indices[16])
+	{
+		c0 = to565(end0);
+		c1 = to565(end1);
+		if (c0 < c1)
+			std::swap(c0, c1);
+		float colors[4][3];
+		palette(c0, c1, colors);
+		if (c0 == c1)
+		{
+			// would decode in 3-colour mode, so stick to index 0
+			std::fill(indices, indices + 16, static_cast<unsigned char>(0));
+			float error = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				const float dr = block.r[i] - colors[0][0], dg = block.g[i] - colors[0][1], db = block.b[i] - colors[0][2];
+				error += dr * dr + dg * dg + db * db;
+			}
+			return error;
+		}
+		return fitIndices(block, colors, indices);
+	}
+
+	// least-squares endpoints for fixed indices; false when the indices don't pin both down
+	inline bool refitEndpoints(const ColorBlock& block, const unsigned char indices[16], float end0[3], float end1[3])
+	{
+		static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f, ap[3] = { 0.0f, 0.0f, 0.0f }, bp[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			const float alpha = weights[indices[i]], beta = 1.0f - alpha;
+			const float texel[3] = { block.r[i], block.g[i], block.b[i] };
+			aa += alpha * alpha;
+			ab += alpha * beta;
+			bb += beta * beta;
+			for (int c = 0; c < 3; c++)
+			{
+				ap[c] += alpha * texel[c];
+				bp[c] += beta * texel[c];
+			}
+		}
+		const float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+			return false;
+		for (int c = 0; c < 3; c++)
+		{
+			end0[c] = std::min(255.0f, std::max(0.0f, (bb * ap[c] - ab * bp[c]) / determinant));
+			end1[c] = std::min(255.0f, std::max(0.0f, (aa * bp[c] - ab * ap[c]) / determinant));
+		}
+		return true;
+	}
+
+	// principal axis endpoints, then a couple of least-squares refits kept while they lower the error
+	inline void compressColorBlock(const ColorBlock& block, unsigned char out[8])
+	{
+		float mean[3], axis[3], minProjection, maxProjection;
+		principalAxis(block, mean, axis, minProjection, maxProjection);
+		float end0[3], end1[3];
+		for (int c = 0; c < 3; c++)
+		{
+			end0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxProjection));
+			end1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minProjection));
+		}
+
+		uint16_t c0, c1;
+		unsigned char indices[16];
+		float error = evaluateEndpoints(block, end0, end1, c0, c1, indices);
+		for (int iteration = 0; iteration < 2 && error > 0.0f; iteration++)
+		{
+			if (!refitEndpoints(block, indices, end0, end1))
+				break;
+			uint16_t refit0, refit1;
+			unsigned char refitIndices[16];
+			const float refitError = evaluateEndpoints(block, end0, end1, refit0, refit1, refitIndices);
+			if (refitError >= error)
+				break;
+			error = refitError;
+			c0 = refit0;
+			c1 = refit1;
+			std::memcpy(indices, refitIndices, 16);
+		}
+
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; i++)
+			bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+		out[0] = static_cast<unsigned char>(c0);
+		out[1] = static_cast<unsigned char>(c0 >> 8);
+		out[2] = static_cast<unsigned char>(c1);
+		out[3] = static_cast<unsigned char>(c1 >> 8);
+		std::memcpy(out + 4, &bits, 4); // little endian
+	}
+
+	// one BC4 block (also the alpha half of DXT5) in the 8-value mode, indices rounded to the nearest step
+	inline void compressBC4Block(const unsigned char values[16], unsigned char out[8])
+	{
+		const unsigned char maxValue = *std::max_element(values, values + 16);
+		const unsigned char minValue = *std::min_element(values, values + 16);
+		std::memset(out, 0, 8);
+		out[0] = maxValue;
+		out[1] = minValue;
+		if (maxValue == minValue)
+			return;
+
+		const int range = maxValue - minValue;
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			// nearest of the 8 steps; step 7 is out[0], step 0 is out[1], steps in between are codes 6..2
+			const int step = (14 * (values[i] - minValue) + range) / (2 * range);
+			const uint64_t code = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+			bits |= code << (3 * i);
+		}
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+	}
+
+	// one row of 4x4 blocks; partial blocks repeat the edge texels
+	inline void compressBlockRow(const unsigned char* rgba, int width, int height, int blockY, DXTFormat format, unsigned char* out)
+	{
+		ColorBlock block;
+		unsigned char channel0[16], channel1[16];
+		for (int bx = 0; bx < width; bx += 4)
+		{
+#if defined(DXT_ENCODER_USE_SSE)
+			if (bx + 4 <= width && blockY * 4 + 4 <= height && format != DXT_FORMAT_BC5)
+			{
+				// whole block: one load per row, channels split with masks and shifts
+				const __m128i byteMask = _mm_set1_epi32(0xFF);
+				for (int row = 0; row < 4; row++)
+				{
+					const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + (static_cast<size_t>(blockY * 4 + row) * width + bx) * 4));
+					_mm_store_ps(block.r + row * 4, _mm_cvtepi32_ps(_mm_and_si128(texels, byteMask)));
+					_mm_store_ps(block.g + row * 4, _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 8), byteMask)));
+					_mm_store_ps(block.b + row * 4, _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 16), byteMask)));
+					alignas(16) int32_t alpha[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(alpha), _mm_srli_epi32(texels, 24));
+					for (int i = 0; i < 4; i++)
+						channel0[row * 4 + i] = static_cast<unsigned char>(alpha[i]);
+				}
+			}
+			else
+#endif
+			for (int i = 0; i < 16; i++)
+			{
+				const int x = std::min(bx + i % 4, width - 1);
+				const int y = std::min(blockY * 4 + i / 4, height - 1);
+				const unsigned char* texel = rgba + (static_cast<size_t>(y) * width + x) * 4;
+				block.r[i] = texel[0];
+				block.g[i] = texel[1];
+				block.b[i] = texel[2];
+				channel0[i] = format == DXT_FORMAT_BC5 ? texel[0] : texel[3];
+				channel1[i] = texel[1];
+			}
+
+			if (format == DXT_FORMAT_DXT1)
+			{
+				compressColorBlock(block, out);
+				out += 8;
+			}
+			else if (format == DXT_FORMAT_DXT5)
+			{
+				compressBC4Block(channel0, out);
+				compressColorBlock(block, out + 8);
+				out += 16;
+			}
+			else
+			{
+				compressBC4Block(channel0, out);
+				compressBC4Block(channel1, out + 8);
+				out += 16;
+			}
+		}
+	}
+}
+
+// Block-compresses tightly packed RGBA8. Rows of 4x4 blocks are spread over the pool; each colour block gets
+// principal-axis endpoints and least-squares refits, with the moments, projections and index search in SSE.
+inline std::vector<unsigned char> EncodeDXT(const unsigned char* rgba, int width, int height, DXTFormat format,
+	ThreadPool& pool = ThreadPool::global(), DXTEncodeStats* stats = nullptr)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	std::vector<unsigned char> out(DXTImageSize(format, width, height));
+	const size_t rowBytes = static_cast<size_t>((width + 3) / 4) * DXTBlockSize(format);
+	const size_t blockRows = static_cast<size_t>((height + 3) / 4);
+	// a few rows per task so small mips don't drown in scheduling
+	const size_t grain = std::max<size_t>(1, 4096 / std::max<size_t>(1, static_cast<size_t>(width)));
+	pool.parallelFor(blockRows, grain, [&](size_t begin, size_t end)
+	{
+		for (size_t row = begin; row < end; row++)
+			dxt_detail::compressBlockRow(rgba, width, height, static_cast<int>(row), format, out.data() + row * rowBytes);
+	});
+
+	if (stats)
+	{
+		stats->pixels += static_cast<size_t>(width) * height;
+		stats->milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+	return out;
+}
+
+// Reference decoder, for measuring encoders; BC5 comes out as (r, g, 0, 255)
+inline std::vector<unsigned char> DecodeDXT(const unsigned char* blocks, int width, int height, DXTFormat format)
+{
+	std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+	const auto decodeBC4 = [](const unsigned char* block, unsigned char values[8])
+	{
+		values[0] = block[0];
+		values[1] = block[1];
+		for (int k = 2; k < 8; k++)
+			values[k] = block[0] > block[1]
+				? static_cast<unsigned char>(((8 - k) * block[0] + (k - 1) * block[1]) / 7)
+				: k < 6 ? static_cast<unsigned char>(((6 - k) * block[0] + (k - 1) * block[1]) / 5) : (k == 6 ? 0 : 255);
+	};
+	const auto bc4Index = [](const unsigned char* block, int i)
+	{
+		uint64_t bits = 0;
+		for (int b = 0; b < 6; b++)
+			bits |= static_cast<uint64_t>(block[2 + b]) << (8 * b);
+		return static_cast<int>((bits >> (3 * i)) & 7);
+	};
+
+	const unsigned char* block = blocks;
+	for (int by = 0; by < height; by += 4)
+	{
+		for (int bx = 0; bx < width; bx += 4)
+		{
+			unsigned char texels[16][4];
+			if (format == DXT_FORMAT_BC5)
+			{
+				unsigned char red[8], green[8];
+				decodeBC4(block, red);
+				decodeBC4(block + 8, green);
+				for (int i = 0; i < 16; i++)
+				{
+					texels[i][0] = red[bc4Index(block, i)];
+					texels[i][1] = green[bc4Index(block + 8, i)];
+					texels[i][2] = 0;
+					texels[i][3] = 255;
+				}
+			}
+			else
+			{
+				const unsigned char* color = format == DXT_FORMAT_DXT5 ? block + 8 : block;
+				const uint16_t c0 = static_cast<uint16_t>(color[0] | color[1] << 8), c1 = static_cast<uint16_t>(color[2] | color[3] << 8);
+				int a[3], b[3], colors[4][4];
+				dxt_detail::from565(c0, a);
+				dxt_detail::from565(c1, b);
+				// DXT5 colour blocks are always 4-colour
+				const bool fourColor = c0 > c1 || format == DXT_FORMAT_DXT5;
+				for (int c = 0; c < 3; c++)
+				{
+					colors[0][c] = a[c];
+					colors[1][c] = b[c];
+					colors[2][c] = fourColor ? (2 * a[c] + b[c]) / 3 : (a[c] + b[c]) / 2;
+					colors[3][c] = fourColor ? (a[c] + 2 * b[c]) / 3 : 0;
+				}
+				colors[0][3] = colors[1][3] = colors[2][3] = 255;
+				colors[3][3] = fourColor ? 255 : 0;
+				uint32_t bits;
+				std::memcpy(&bits, color + 4, 4);
+
+				unsigned char alpha[8];
+				if (format == DXT_FORMAT_DXT5)
+					decodeBC4(block, alpha);
+				for (int i = 0; i < 16; i++)
+				{
+					const int index = (bits >> (2 * i)) & 3;
+					for (int c = 0; c < 4; c++)
+						texels[i][c] = static_cast<unsigned char>(colors[index][c]);
+					if (format == DXT_FORMAT_DXT5)
+						texels[i][3] = alpha[bc4Index(block, i)];
+				}
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				const int x = bx + i % 4, y = by + i / 4;
+				if (x < width && y < height)
+					std::memcpy(&rgba[(static_cast<size_t>(y) * width + x) * 4], texels[i], 4);
+			}
+			block += DXTBlockSize(format);
+		}
+	}
+	return rgba;
+}
+
+// PSNR in dB over the channels the format keeps (RGB for DXT1, RGBA for DXT5, RG for BC5)
+inline double DXTPeakSignalToNoise(const unsigned char* original, const unsigned char* decoded, int width, int height, DXTFormat format)
+{
+	const int channels = format == DXT_FORMAT_DXT1 ? 3 : format == DXT_FORMAT_DXT5 ? 4 : 2;
+	double squaredError = 0.0;
+	const size_t texels = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < texels; i++)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			const double d = static_cast<double>(original[i * 4 + c]) - decoded[i * 4 + c];
+			squaredError += d * d;
+		}
+	}
+	const double meanSquaredError = squaredError / (static_cast<double>(texels) * channels);
+	return meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+}
+#endif
@@ -5,6 +5,29 @@
 #include <list> //std::list
 #include <array> //std::array
 #include <memory> //std::unique_ptr
+#include <vector> //std::vector
+#include <chrono> //std::chrono
+#include <ostream> //std::ostream
+#include <random> //std::mt19937
+
+#include <learnopengl/bvh.h>
+#include <learnopengl/frustum_culler.h>
+#include <learnopengl/gpu_occlusion.h>
+#include <learnopengl/impostor.h>
+#include <learnopengl/mesh_lod.h>
+#include <learnopengl/meshlet.h>
+#include <learnopengl/occlusion_culler.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/static_batch.h>
+#include <learnopengl/transform_hierarchy.h>
+
+class Entity;
+
+//Entities whose local transform changed since the last Entity::updateDirty, filled by the Transform setters
+struct DirtyEntityList
+{
+	std::vector<Entity*> entities;
+};
 
 class Transform
 {
@@ -20,6 +43,19 @@ protected:
 	//Dirty flag
 	bool m_isDirty = true;
 
+	//Change tracking, the owner is queued the first time it goes from clean to dirty
+	Entity* m_owner = nullptr;
+	DirtyEntityList* m_dirtyList = nullptr;
+
+	void markDirty()
+	{
+		if (m_isDirty)
+			return;
+		m_isDirty = true;
+		if (m_dirtyList)
+			m_dirtyList->entities.push_back(m_owner);
+	}
+
 protected:
 	glm::mat4 getLocalModelMatrix()
 	{
@@ -50,19 +86,28 @@ public:
 	void setLocalPosition(const glm::vec3& newPosition)
 	{
 		m_pos = newPosition;
-		m_isDirty = true;
+		markDirty();
 	}
 
 	void setLocalRotation(const glm::vec3& newRotation)
 	{
 		m_eulerRot = newRotation;
-		m_isDirty = true;
+		markDirty();
 	}
 
 	void setLocalScale(const glm::vec3& newScale)
 	{
 		m_scale = newScale;
-		m_isDirty = true;
+		markDirty();
+	}
+
+	void setChangeTracking(Entity* owner, DirtyEntityList* dirtyList)
+	{
+		m_owner = owner;
+		m_dirtyList = dirtyList;
+		//Already dirty transforms still have to reach the list
+		if (m_isDirty && m_dirtyList)
+			m_dirtyList->entities.push_back(m_owner);
 	}
 
 	const glm::vec3& getGlobalPosition() const
@@ -342,45 +387,51 @@ Frustum createFrustumFromCamera(const Camera& cam, float aspect, float fovY, flo
 	return frustum;
 }
 
-AABB generateAABB(const Model& model)
+//Same planes as FrustumPlanes::fromViewProjection, in the Plane form used by the BoundingVolume tests
+inline Frustum createFrustumFromViewProjection(const glm::mat4& viewProjection)
 {
-	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
-	for (auto&& mesh : model.meshes)
-	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
-
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
+	const FrustumPlanes planes = FrustumPlanes::fromViewProjection(viewProjection);
+	Plane* faces[6];
+	Frustum frustum;
+	faces[0] = &frustum.leftFace;
+	faces[1] = &frustum.rightFace;
+	faces[2] = &frustum.bottomFace;
+	faces[3] = &frustum.topFace;
+	faces[4] = &frustum.nearFace;
+	faces[5] = &frustum.farFace;
+	for (int i = 0; i < 6; i++)
+	{
+		faces[i]->normal = glm::vec3(planes.planes[i]);
+		faces[i]->distance = -planes.planes[i].w;
 	}
-	return AABB(minAABB, maxAABB);
+	return frustum;
+}
+
+//Bounds are computed once per mesh at import (see Mesh::computeBounds), so these are O(1)
+AABB generateAABB(const Model& model)
+{
+	return AABB(model.aabbMin, model.aabbMax);
 }
 
 Sphere generateSphereBV(const Model& model)
 {
-	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
-	for (auto&& mesh : model.meshes)
-	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
+	//Sphere::isOnFrustum halves the radius together with the scale, so store the diameter
+	return Sphere(model.sphereCenter, model.sphereRadius * 2.0f);
+}
 
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
-	}
+//Pose bounds of skinned models (model_animation.h); the static Model of model.h has no bones, so its
+//entities keep their bind-pose bounds. The int/long argument picks the first overload when it compiles.
+template<typename TModel>
+auto computeAnimatedAABB(const TModel& model, const std::vector<glm::mat4>& palette, glm::vec3& outMin, glm::vec3& outMax, int)
+	-> decltype(model.ComputeAnimatedAABB(palette, outMin, outMax))
+{
+	return model.ComputeAnimatedAABB(palette, outMin, outMax);
+}
 
-	return Sphere((maxAABB + minAABB) * 0.5f, glm::length(minAABB - maxAABB));
+template<typename TModel>
+bool computeAnimatedAABB(const TModel&, const std::vector<glm::mat4>&, glm::vec3&, glm::vec3&, long)
+{
+	return false;
 }
 
 class Entity
@@ -396,6 +447,29 @@ public:
 	Model* pModel = nullptr;
 	std::unique_ptr<AABB> boundingVolume;
 
+	//Set by trackChanges
+	DirtyEntityList* dirtyList = nullptr;
+
+	//Leaf in a BVH, see addSelfAndChildToBVH
+	int bvhProxy = BVH::NULL_NODE;
+
+	//Slot in an OcclusionQueryCuller, see drawSelfAndChildWithQueries
+	int occlusionQuery = -1;
+
+	//Level of detail drawn, picked by updateLODSelfAndChild
+	unsigned int lod = 0;
+
+	//Rasterized into the software occlusion buffer, see addOccludersSelfAndChild
+	bool isOccluder = false;
+
+	//Never moves once placed, baked into a StaticBatch by addStaticSelfAndChild
+	bool isStatic = false;
+	//Set by addStaticSelfAndChild, the batch draws this entity so the per-entity draws skip it
+	bool inStaticBatch = false;
+
+	//Bone palette of a skinned model (Animator::GetFinalBoneMatrices()), see updateAnimatedBoundsSelfAndChild
+	const std::vector<glm::mat4>* pBonePalette = nullptr;
+
 
 	// constructor, expects a filepath to a 3D model.
 	Entity(Model& model) : pModel{ &model }
@@ -429,12 +503,159 @@ public:
 		return AABB(globalCenter, newIi, newIj, newIk);
 	}
 
+	//Refit the local bounds of animated entities to the current pose. Call after Animator::UpdateAnimation so
+	//frustum, BVH and occlusion tests see swinging limbs; bind-pose bounds are kept for static entities.
+	//Proxies of refitted entities are moved in bvh when one is given.
+	void updateAnimatedBoundsSelfAndChild(BVH* bvh = nullptr)
+	{
+		glm::vec3 minAABB, maxAABB;
+		if (pBonePalette && computeAnimatedAABB(*pModel, *pBonePalette, minAABB, maxAABB, 0))
+		{
+			*boundingVolume = AABB(minAABB, maxAABB);
+			if (bvh)
+				moveBVHProxy(*bvh);
+		}
+
+		for (auto&& child : children)
+		{
+			child->updateAnimatedBoundsSelfAndChild(bvh);
+		}
+	}
+
 	//Add child. Argument input is argument of any constructor that you create. By default you can use the default constructor and don't put argument input.
 	template<typename... TArgs>
 	void addChild(TArgs&... args)
 	{
 		children.emplace_back(std::make_unique<Entity>(args...));
 		children.back()->parent = this;
+		if (dirtyList)
+			children.back()->trackChanges(*dirtyList);
+	}
+
+	//Route transform changes of this entity and its subtree (including children added later) to list
+	void trackChanges(DirtyEntityList& list)
+	{
+		dirtyList = &list;
+		transform.setChangeTracking(this, &list);
+
+		for (auto&& child : children)
+		{
+			child->trackChanges(list);
+		}
+	}
+
+	//Update only the subtrees whose root was edited since the last call. Cost scales with the number of
+	//edits instead of the number of entities. With a bvh, the proxies of the refreshed subtrees are moved too.
+	static void updateDirty(DirtyEntityList& list, BVH* bvh = nullptr)
+	{
+		for (Entity* entity : list.entities)
+		{
+			//Already refreshed as part of another edited subtree
+			if (!entity->transform.isDirty())
+				continue;
+
+			//Refresh from the topmost dirty ancestor; it may not be in the list (untracked, or created dirty above a
+			//subtree passed to trackChanges), and skipping this entry would leave it dirty and never queued again
+			Entity* root = entity;
+			for (Entity* ancestor = entity->parent; ancestor; ancestor = ancestor->parent)
+			{
+				if (ancestor->transform.isDirty())
+					root = ancestor;
+			}
+			root->forceUpdateSelfAndChild();
+			if (bvh)
+				root->updateSelfAndChildInBVH(*bvh);
+		}
+		list.entities.clear();
+	}
+
+	//Flattens the subtree in depth-first order, e.g. to fill a BatchFrustumCuller from getGlobalAABB()
+	void collectSelfAndChild(std::vector<Entity*>& out)
+	{
+		out.push_back(this);
+		for (auto&& child : children)
+		{
+			child->collectSelfAndChild(out);
+		}
+	}
+
+	//Registers world AABBs of this subtree as BVH leaves whose user data is the Entity*
+	void addSelfAndChildToBVH(BVH& bvh)
+	{
+		const AABB globalAABB = getGlobalAABB();
+		bvhProxy = bvh.createProxy(BVHBounds::fromCenterExtents(globalAABB.center, globalAABB.extents), this);
+
+		for (auto&& child : children)
+		{
+			child->addSelfAndChildToBVH(bvh);
+		}
+	}
+
+	//Moves the proxies of this subtree after its transforms were updated. Only entities that left their fattened
+	//leaf box change the tree. Per frame, prefer updateDirty(list, &bvh), which only visits edited subtrees.
+	void updateSelfAndChildInBVH(BVH& bvh)
+	{
+		moveBVHProxy(bvh);
+
+		for (auto&& child : children)
+		{
+			child->updateSelfAndChildInBVH(bvh);
+		}
+	}
+
+	//Picks each entity's level of detail from the projected size of its bounding sphere, with hysteresis.
+	//projectionScaleY is projection[1][1].
+	void updateLODSelfAndChild(const glm::vec3& cameraPosition, float projectionScaleY, const LODSelection& selection = LODSelection())
+	{
+		const glm::mat4& model = transform.getModelMatrix();
+		const glm::vec3 center{ model * glm::vec4(pModel->sphereCenter, 1.f) };
+		const float maxScale = std::max(std::max(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))), glm::length(glm::vec3(model[2])));
+		const float radius = pModel->sphereRadius * maxScale;
+		lod = selection.select(LODSelection::screenSize(radius, glm::length(center - cameraPosition), projectionScaleY), lod, pModel->GetLODCount());
+
+		for (auto&& child : children)
+		{
+			child->updateLODSelfAndChild(cameraPosition, projectionScaleY, selection);
+		}
+	}
+
+	//Feeds the entities flagged isOccluder to the culler, call between its beginFrame and render
+	void addOccludersSelfAndChild(SoftwareOcclusionCuller& culler)
+	{
+		if (isOccluder)
+			culler.addOccluderModel(*pModel, transform.getModelMatrix());
+
+		for (auto&& child : children)
+		{
+			child->addOccludersSelfAndChild(culler);
+		}
+	}
+
+	//Bakes the entities flagged isStatic into batch with their current world transform, call batch.build() after.
+	//Transforms have to be up to date (updateSelfAndChild) and must not change afterwards.
+	void addStaticSelfAndChild(StaticBatch& batch)
+	{
+		if (isStatic)
+		{
+			batch.addModel(*pModel, transform.getModelMatrix());
+			inStaticBatch = true;
+		}
+
+		for (auto&& child : children)
+		{
+			child->addStaticSelfAndChild(batch);
+		}
+	}
+
+	//Frustum test followed by the occlusion test when a culler is given
+	bool isVisible(const Frustum& frustum, const SoftwareOcclusionCuller* occlusion)
+	{
+		if (!boundingVolume->isOnFrustum(frustum, transform))
+			return false;
+		if (!occlusion)
+			return true;
+		const AABB globalAABB = getGlobalAABB();
+		return !occlusion->isOccluded(globalAABB.center, globalAABB.extents);
 	}
 
 	//Update transform if it was changed
@@ -466,20 +687,297 @@ public:
 	}
 
 
-	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, unsigned int& display, unsigned int& total)
+	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, unsigned int& display, unsigned int& total, const SoftwareOcclusionCuller* occlusion = nullptr)
 	{
-		if (boundingVolume->isOnFrustum(frustum, transform))
+		if (!inStaticBatch && isVisible(frustum, occlusion))
 		{
 			ourShader.setMat4("model", transform.getModelMatrix());
-			pModel->Draw(ourShader);
+			pModel->Draw(ourShader, lod);
+			display++;
+		}
+		total++;
+
+		for (auto&& child : children)
+		{
+			child->drawSelfAndChild(frustum, ourShader, display, total, occlusion);
+		}
+	}
+
+	//Entity frustum test first, then per-cluster frustum and backface culling inside the visible models.
+	//The culler's beginFrame has to be called with this frame's camera.
+	void drawSelfAndChildClusters(const Frustum& frustum, Shader& ourShader, MeshletCuller& clusters, unsigned int& display, unsigned int& total)
+	{
+		if (!inStaticBatch && boundingVolume->isOnFrustum(frustum, transform))
+		{
+			ourShader.setMat4("model", transform.getModelMatrix());
+			clusters.drawModel(*pModel, ourShader, transform.getModelMatrix());
+			display++;
+		}
+		total++;
+
+		for (auto&& child : children)
+		{
+			child->drawSelfAndChildClusters(frustum, ourShader, clusters, display, total);
+		}
+	}
+
+	//Entities further than impostorDistance from the camera whose model has an atlas registered in impostors
+	//are queued there instead of drawn; impostors.begin() before and impostors.flush() after this call.
+	void drawSelfAndChildImpostors(const Frustum& frustum, Shader& ourShader, ImpostorRenderer& impostors, const glm::vec3& cameraPosition, float impostorDistance, unsigned int& display, unsigned int& total)
+	{
+		if (!inStaticBatch && boundingVolume->isOnFrustum(frustum, transform))
+		{
+			const glm::mat4& modelMatrix = transform.getModelMatrix();
+			if (glm::distance(glm::vec3(modelMatrix[3]), cameraPosition) > impostorDistance && impostors.hasImpostor(pModel))
+			{
+				impostors.add(pModel, modelMatrix);
+			}
+			else
+			{
+				ourShader.setMat4("model", modelMatrix);
+				pModel->Draw(ourShader, lod);
+			}
+			display++;
+		}
+		total++;
+
+		for (auto&& child : children)
+		{
+			child->drawSelfAndChildImpostors(frustum, ourShader, impostors, cameraPosition, impostorDistance, display, total);
+		}
+	}
+
+	//Hardware occlusion query variant. Entities passing the frustum test are collected first so all proxy boxes
+	//go out in one batch; draw the big occluders before calling this so the proxies have depth to test against.
+	void drawSelfAndChildWithQueries(const Frustum& frustum, Shader& ourShader, OcclusionQueryCuller& queries, unsigned int& display, unsigned int& total)
+	{
+		std::vector<Entity*> candidates;
+		collectOnFrustum(frustum, candidates, total);
+		for (Entity* entity : candidates)
+		{
+			entity->occlusionQuery = queries.acquire(entity->occlusionQuery);
+		}
+
+		if (queries.getMode() == OCCLUSION_QUERY_CONDITIONAL)
+		{
+			addProxies(candidates, queries);
+			queries.issueQueries();
+			ourShader.use();
+			for (Entity* entity : candidates)
+			{
+				queries.beginConditional(entity->occlusionQuery);
+				ourShader.setMat4("model", entity->transform.getModelMatrix());
+				entity->pModel->Draw(ourShader, entity->lod);
+				queries.endConditional();
+				display++;
+			}
+		}
+		else
+		{
+			//Results from an earlier frame, the proxies issued now test against this frame's depth
+			for (Entity* entity : candidates)
+			{
+				if (!queries.isVisible(entity->occlusionQuery))
+					continue;
+				ourShader.setMat4("model", entity->transform.getModelMatrix());
+				entity->pModel->Draw(ourShader, entity->lod);
+				display++;
+			}
+			addProxies(candidates, queries);
+			queries.issueQueries();
+			ourShader.use();
+		}
+	}
+
+	//Same culling as drawSelfAndChild but only records draw items, RenderQueue::flush() issues them sorted
+	void queueSelfAndChild(const Frustum& frustum, Shader& ourShader, RenderQueue& queue, unsigned int& display, unsigned int& total, const SoftwareOcclusionCuller* occlusion = nullptr)
+	{
+		if (!inStaticBatch && isVisible(frustum, occlusion))
+		{
+			queue.pushModel(*pModel, ourShader, transform.getModelMatrix(), RENDER_PASS_OPAQUE, lod);
 			display++;
 		}
 		total++;
 
 		for (auto&& child : children)
 		{
-			child->drawSelfAndChild(frustum, ourShader, display, total);
+			child->queueSelfAndChild(frustum, ourShader, queue, display, total, occlusion);
 		}
 	}
+
+private:
+	void moveBVHProxy(BVH& bvh)
+	{
+		if (bvhProxy == BVH::NULL_NODE)
+			return;
+		const AABB globalAABB = getGlobalAABB();
+		bvh.moveProxy(bvhProxy, BVHBounds::fromCenterExtents(globalAABB.center, globalAABB.extents));
+	}
+
+	void collectOnFrustum(const Frustum& frustum, std::vector<Entity*>& out, unsigned int& total)
+	{
+		if (!inStaticBatch && boundingVolume->isOnFrustum(frustum, transform))
+			out.push_back(this);
+		total++;
+
+		for (auto&& child : children)
+		{
+			child->collectOnFrustum(frustum, out, total);
+		}
+	}
+
+	static void addProxies(const std::vector<Entity*>& entities, OcclusionQueryCuller& queries)
+	{
+		for (Entity* entity : entities)
+		{
+			const AABB globalAABB = entity->getGlobalAABB();
+			queries.addProxy(entity->occlusionQuery, globalAABB.center, globalAABB.extents);
+		}
+	}
+};
+
+struct TransformHierarchyBenchmark
+{
+	size_t nodes = 0;
+	double entityMilliseconds = 0.0;       //Entity::updateSelfAndChild after the root was edited
+	double flatMilliseconds = 0.0;         //TransformHierarchy::updateWorld
+	double flatParallelMilliseconds = 0.0; //TransformHierarchy::updateWorldParallel
+	float maxError = 0.0f;                 //largest difference between the two world matrices of a node
+
+	void print(std::ostream& out) const
+	{
+		out << nodes << " nodes: Entity " << entityMilliseconds << " ms, TransformHierarchy " << flatMilliseconds
+			<< " ms, parallel " << flatParallelMilliseconds << " ms, max error " << maxError << std::endl;
+	}
+};
+
+//Full updates of the same random tree (each node's parent among the previous 50) as Entity children and as
+//TransformHierarchy nodes, averaged over iterations. model only provides the entities' bounds.
+inline TransformHierarchyBenchmark BenchmarkTransformHierarchy(Model& model, size_t nodeCount = 100000, unsigned int iterations = 10, ThreadPool& pool = ThreadPool::global())
+{
+	TransformHierarchyBenchmark result;
+	result.nodes = nodeCount;
+	if (nodeCount == 0 || iterations == 0)
+		return result;
+
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+	std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+	std::uniform_real_distribution<float> scale(0.9f, 1.1f);
+
+	Entity root(model);
+	std::vector<Entity*> entities{ &root };
+	TransformHierarchy hierarchy;
+	hierarchy.reserve(nodeCount);
+	hierarchy.create();
+	for (size_t i = 1; i < nodeCount; i++)
+	{
+		const size_t parent = i - 1 - generator() % std::min<size_t>(i, 50);
+		const glm::vec3 position(offset(generator), offset(generator), offset(generator));
+		const glm::vec3 rotation(angle(generator), angle(generator), angle(generator));
+		const glm::vec3 nodeScale(scale(generator));
+
+		entities[parent]->addChild(model);
+		Entity* entity = entities[parent]->children.back().get();
+		entity->transform.setLocalPosition(position);
+		entity->transform.setLocalRotation(rotation);
+		entity->transform.setLocalScale(nodeScale);
+		entities.push_back(entity);
+
+		hierarchy.create(static_cast<TransformHierarchy::NodeId>(parent), position, TransformHierarchy::eulerToQuat(rotation), nodeScale);
+	}
+
+	auto time = [iterations](auto&& update)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < iterations; i++)
+			update();
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+	};
+	result.entityMilliseconds = time([&]()
+	{
+		//an edited root makes the whole tree dirty
+		root.transform.setLocalPosition(root.transform.getLocalPosition());
+		root.updateSelfAndChild();
+	});
+	result.flatMilliseconds = time([&]() { hierarchy.updateWorld(); });
+	result.flatParallelMilliseconds = time([&]() { hierarchy.updateWorldParallel(pool); });
+
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		const glm::mat4 difference = entities[i]->transform.getModelMatrix() - hierarchy.world[i];
+		for (int column = 0; column < 4; column++)
+			result.maxError = std::max(result.maxError, glm::length(difference[column]));
+	}
+	return result;
+}
+
+struct FrustumCullingBenchmark
+{
+	size_t boxes = 0;
+	size_t entityVisible = 0;
+	size_t batchVisible = 0;
+	double entityMilliseconds = 0.0;        //AABB::isOnFrustum per entity, the test drawSelfAndChild makes
+	double batchMilliseconds = 0.0;         //BatchFrustumCuller::cull
+	double batchParallelMilliseconds = 0.0; //BatchFrustumCuller::cullParallel
+
+	void print(std::ostream& out) const
+	{
+		out << boxes << " boxes: Entity " << entityMilliseconds << " ms (" << entityVisible << " visible), batch "
+			<< batchMilliseconds << " ms, parallel " << batchParallelMilliseconds << " ms (" << batchVisible << " visible)" << std::endl;
+	}
 };
+
+//Culls count entities scattered in a worldSize cube both ways, averaged over iterations. The per-entity path
+//walks a flat list instead of recursing, so it is measured slightly in its favour. model only provides the bounds.
+inline FrustumCullingBenchmark BenchmarkFrustumCulling(Model& model, const glm::mat4& viewProjection, size_t count = 1000000, float worldSize = 400.0f,
+	unsigned int iterations = 10, ThreadPool& pool = ThreadPool::global())
+{
+	FrustumCullingBenchmark result;
+	result.boxes = count;
+	if (count == 0 || iterations == 0)
+		return result;
+
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> position(-0.5f * worldSize, 0.5f * worldSize);
+	Entity root(model);
+	for (size_t i = 1; i < count; i++)
+	{
+		root.addChild(model);
+		root.children.back()->transform.setLocalPosition(glm::vec3(position(generator), position(generator), position(generator)));
+	}
+	root.updateSelfAndChild();
+
+	std::vector<Entity*> entities;
+	entities.reserve(count);
+	root.collectSelfAndChild(entities);
+	BatchFrustumCuller culler;
+	culler.reserve(count);
+	for (Entity* entity : entities)
+	{
+		const AABB globalAABB = entity->getGlobalAABB();
+		culler.add(globalAABB.center, globalAABB.extents);
+	}
+
+	const Frustum frustum = createFrustumFromViewProjection(viewProjection);
+	const FrustumPlanes planes = FrustumPlanes::fromViewProjection(viewProjection);
+	std::vector<uint32_t> visible;
+	auto time = [iterations](auto&& cull)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < iterations; i++)
+			cull();
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+	};
+	result.entityMilliseconds = time([&]()
+	{
+		result.entityVisible = 0;
+		for (Entity* entity : entities)
+			result.entityVisible += entity->boundingVolume->isOnFrustum(frustum, entity->transform) ? 1 : 0;
+	});
+	result.batchMilliseconds = time([&]() { culler.cull(planes, visible); });
+	result.batchParallelMilliseconds = time([&]() { culler.cullParallel(planes, visible, pool); });
+	result.batchVisible = visible.size();
+	return result;
+}
 #endif
@@ -0,0 +1,231 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_USE_SSE 1
+#endif
+#if defined(__AVX__)
+#define FRUSTUM_CULLER_USE_AVX 1
+#endif
+
+// The six frustum planes as (normal, w) with dot(normal, p) + w >= 0 inside, normalized.
+// Order: left, right, bottom, top, near, far.
+struct FrustumPlanes
+{
+	glm::vec4 planes[6];
+
+	// Gribb/Hartmann extraction straight from the view-projection matrix
+	static FrustumPlanes fromViewProjection(const glm::mat4& viewProjection)
+	{
+		const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		FrustumPlanes result;
+		result.planes[0] = row3 + row0;
+		result.planes[1] = row3 - row0;
+		result.planes[2] = row3 + row1;
+		result.planes[3] = row3 - row1;
+		result.planes[4] = row3 + row2;
+		result.planes[5] = row3 - row2;
+		for (glm::vec4& plane : result.planes)
+			plane /= glm::length(glm::vec3(plane));
+		return result;
+	}
+
+	bool isAABBVisible(const glm::vec3& center, const glm::vec3& extents) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			const float d = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			const float r = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y + std::abs(plane.z) * extents.z;
+			if (d + r < 0.0f)
+				return false;
+		}
+		return true;
+	}
+};
+
+// Box that encloses the local box (center, extents) after the affine transform m
+inline void transformAABB(const glm::mat4& m, const glm::vec3& center, const glm::vec3& extents, glm::vec3& outCenter, glm::vec3& outExtents)
+{
+	outCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+	outExtents = glm::abs(glm::vec3(m[0])) * extents.x + glm::abs(glm::vec3(m[1])) * extents.y + glm::abs(glm::vec3(m[2])) * extents.z;
+}
+
+// World-space AABBs in SoA arrays, tested 4 (SSE) or 8 (AVX) at a time against the frustum planes.
+// Indices returned by add() are what cull() writes into the visibility list.
+class BatchFrustumCuller
+{
+public:
+	void reserve(size_t count)
+	{
+		for (std::vector<float>* array : arrays())
+			array->reserve(count);
+	}
+
+	void clear()
+	{
+		for (std::vector<float>* array : arrays())
+			array->clear();
+	}
+
+	uint32_t add(const glm::vec3& center, const glm::vec3& extents)
+	{
+		const uint32_t index = static_cast<uint32_t>(m_CenterX.size());
+		m_CenterX.push_back(center.x);
+		m_CenterY.push_back(center.y);
+		m_CenterZ.push_back(center.z);
+		m_ExtentX.push_back(extents.x);
+		m_ExtentY.push_back(extents.y);
+		m_ExtentZ.push_back(extents.z);
+		return index;
+	}
+
+	void set(uint32_t index, const glm::vec3& center, const glm::vec3& extents)
+	{
+		m_CenterX[index] = center.x;
+		m_CenterY[index] = center.y;
+		m_CenterZ[index] = center.z;
+		m_ExtentX[index] = extents.x;
+		m_ExtentY[index] = extents.y;
+		m_ExtentZ[index] = extents.z;
+	}
+
+	size_t size() const { return m_CenterX.size(); }
+
+	// writes the indices of boxes touching the frustum into visible (replacing its content), in index order
+	void cull(const FrustumPlanes& frustum, std::vector<uint32_t>& visible) const
+	{
+		visible.resize(size());
+		const size_t count = cullRange(frustum, 0, size(), visible.data());
+		visible.resize(count);
+	}
+
+	// same result as cull(), chunks of grainSize boxes run on the pool and are concatenated in order
+	void cullParallel(const FrustumPlanes& frustum, std::vector<uint32_t>& visible, ThreadPool& pool = ThreadPool::global(), size_t grainSize = 16384) const
+	{
+		grainSize = (grainSize + 7) & ~size_t(7);
+		const size_t numChunks = (size() + grainSize - 1) / grainSize;
+		visible.resize(size());
+		std::vector<size_t> chunkCounts(numChunks);
+
+		// every chunk compacts into its own slice of visible first
+		pool.parallelFor(size(), grainSize, [&](size_t begin, size_t end)
+		{
+			chunkCounts[begin / grainSize] = cullRange(frustum, begin, end, visible.data() + begin);
+		});
+
+		size_t total = 0;
+		for (size_t chunk = 0; chunk < numChunks; chunk++)
+		{
+			const size_t begin = chunk * grainSize;
+			if (total != begin)
+				std::copy(visible.begin() + begin, visible.begin() + begin + chunkCounts[chunk], visible.begin() + total);
+			total += chunkCounts[chunk];
+		}
+		visible.resize(total);
+	}
+
+private:
+	std::vector<std::vector<float>*> arrays()
+	{
+		return { &m_CenterX, &m_CenterY, &m_CenterZ, &m_ExtentX, &m_ExtentY, &m_ExtentZ };
+	}
+
+	size_t cullRange(const FrustumPlanes& frustum, size_t begin, size_t end, uint32_t* out) const
+	{
+		size_t count = 0;
+		size_t i = begin;
+
+#if defined(FRUSTUM_CULLER_USE_AVX)
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256 cx = _mm256_loadu_ps(&m_CenterX[i]);
+			const __m256 cy = _mm256_loadu_ps(&m_CenterY[i]);
+			const __m256 cz = _mm256_loadu_ps(&m_CenterZ[i]);
+			const __m256 ex = _mm256_loadu_ps(&m_ExtentX[i]);
+			const __m256 ey = _mm256_loadu_ps(&m_ExtentY[i]);
+			const __m256 ez = _mm256_loadu_ps(&m_ExtentZ[i]);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))),
+					_mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+				__m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(std::abs(plane.x))), _mm256_mul_ps(ey, _mm256_set1_ps(std::abs(plane.y)))),
+					_mm256_mul_ps(ez, _mm256_set1_ps(std::abs(plane.z))));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+
+			int mask = _mm256_movemask_ps(inside);
+			while (mask)
+			{
+				const int lane = ctz(mask);
+				out[count++] = static_cast<uint32_t>(i + lane);
+				mask &= mask - 1;
+			}
+		}
+#endif
+#if defined(FRUSTUM_CULLER_USE_SSE)
+		for (; i + 4 <= end; i += 4)
+		{
+			const __m128 cx = _mm_loadu_ps(&m_CenterX[i]);
+			const __m128 cy = _mm_loadu_ps(&m_CenterY[i]);
+			const __m128 cz = _mm_loadu_ps(&m_CenterZ[i]);
+			const __m128 ex = _mm_loadu_ps(&m_ExtentX[i]);
+			const __m128 ey = _mm_loadu_ps(&m_ExtentY[i]);
+			const __m128 ez = _mm_loadu_ps(&m_ExtentZ[i]);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+					_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.y)))),
+					_mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.z))));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			while (mask)
+			{
+				const int lane = ctz(mask);
+				out[count++] = static_cast<uint32_t>(i + lane);
+				mask &= mask - 1;
+			}
+		}
+#endif
+		for (; i < end; i++)
+		{
+			const glm::vec3 center(m_CenterX[i], m_CenterY[i], m_CenterZ[i]);
+			const glm::vec3 extents(m_ExtentX[i], m_ExtentY[i], m_ExtentZ[i]);
+			if (frustum.isAABBVisible(center, extents))
+				out[count++] = static_cast<uint32_t>(i);
+		}
+		return count;
+	}
+
+	static int ctz(int mask)
+	{
+		int lane = 0;
+		while (!(mask & (1 << lane)))
+			lane++;
+		return lane;
+	}
+
+	std::vector<float> m_CenterX, m_CenterY, m_CenterZ;
+	std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ;
+};
+#endif
@@ -0,0 +1,1081 @@
+#ifndef GLTF_MODEL_H
+#define GLTF_MODEL_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <stb_image.h>
+
+#include <learnopengl/animation.h>
+#include <learnopengl/animdata.h>
+#include <learnopengl/bone.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gltf_detail
+{
+	// read-only mapping of a whole file
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile()
+		{
+#ifdef _WIN32
+			if (m_Data)
+				UnmapViewOfFile(m_Data);
+			if (m_Mapping)
+				CloseHandle(m_Mapping);
+			if (m_File != INVALID_HANDLE_VALUE)
+				CloseHandle(m_File);
+#else
+			if (m_Data)
+				munmap(const_cast<unsigned char*>(m_Data), m_Size);
+#endif
+		}
+
+		bool open(const std::string& path)
+		{
+#ifdef _WIN32
+			m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			LARGE_INTEGER size;
+			if (m_File == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+				return false;
+			m_Mapping = CreateFileMappingA(m_File, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (!m_Mapping)
+				return false;
+			m_Data = static_cast<const unsigned char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+			m_Size = static_cast<size_t>(size.QuadPart);
+#else
+			const int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				return false;
+			struct stat info;
+			if (fstat(fd, &info) == 0 && info.st_size > 0)
+			{
+				void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if (data != MAP_FAILED)
+				{
+					m_Data = static_cast<const unsigned char*>(data);
+					m_Size = static_cast<size_t>(info.st_size);
+				}
+			}
+			::close(fd);
+#endif
+			return m_Data != nullptr;
+		}
+
+		const unsigned char* data() const { return m_Data; }
+		size_t size() const { return m_Size; }
+
+	private:
+		const unsigned char* m_Data = nullptr;
+		size_t m_Size = 0;
+#ifdef _WIN32
+		HANDLE m_File = INVALID_HANDLE_VALUE;
+		HANDLE m_Mapping = NULL;
+#endif
+	};
+
+	// just enough JSON for glTF; objects keep their members in file order
+	struct JsonValue
+	{
+		enum Type { Null, Bool, Number, String, Array, Object };
+		Type type = Null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<JsonValue> array;
+		std::vector<std::pair<std::string, JsonValue>> object;
+
+		// a null value for missing members and out of range indices, so lookups can be chained
+		const JsonValue& operator[](const char* key) const
+		{
+			for (const auto& member : object)
+			{
+				if (member.first == key)
+					return member.second;
+			}
+			return null();
+		}
+
+		const JsonValue& operator[](size_t i) const { return i < array.size() ? array[i] : null(); }
+		const JsonValue& operator[](int i) const { return i >= 0 ? (*this)[static_cast<size_t>(i)] : null(); }
+
+		bool has(const char* key) const { return (*this)[key].type != Null; }
+		size_t size() const { return type == Array ? array.size() : object.size(); }
+		int asInt(int fallback = 0) const { return type == Number ? static_cast<int>(number) : fallback; }
+		float asFloat(float fallback = 0.0f) const { return type == Number ? static_cast<float>(number) : fallback; }
+		bool asBool(bool fallback = false) const { return type == Bool ? boolean : fallback; }
+
+		static const JsonValue& null()
+		{
+			static const JsonValue value;
+			return value;
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* begin, const char* end) : m_Current(begin), m_End(end) {}
+
+		bool parse(JsonValue& value)
+		{
+			return parseValue(value, 0) && (skipWhitespace(), true);
+		}
+
+	private:
+		void skipWhitespace()
+		{
+			while (m_Current < m_End && (*m_Current == ' ' || *m_Current == '\t' || *m_Current == '\n' || *m_Current == '\r'))
+				m_Current++;
+		}
+
+		bool literal(const char* text)
+		{
+			const size_t length = std::strlen(text);
+			if (static_cast<size_t>(m_End - m_Current) < length || std::strncmp(m_Current, text, length) != 0)
+				return false;
+			m_Current += length;
+			return true;
+		}
+
+		bool parseValue(JsonValue& value, int depth)
+		{
+			skipWhitespace();
+			if (m_Current >= m_End || depth > 64)
+				return false;
+			switch (*m_Current)
+			{
+			case '{':
+				return parseObject(value, depth);
+			case '[':
+				return parseArray(value, depth);
+			case '"':
+				value.type = JsonValue::String;
+				return parseString(value.string);
+			case 't':
+				value.type = JsonValue::Bool;
+				value.boolean = true;
+				return literal("true");
+			case 'f':
+				value.type = JsonValue::Bool;
+				return literal("false");
+			case 'n':
+				return literal("null");
+			default:
+				return parseNumber(value);
+			}
+		}
+
+		bool parseObject(JsonValue& value, int depth)
+		{
+			value.type = JsonValue::Object;
+			m_Current++;
+			skipWhitespace();
+			if (m_Current < m_End && *m_Current == '}')
+				return ++m_Current, true;
+			for (;;)
+			{
+				skipWhitespace();
+				std::string key;
+				if (m_Current >= m_End || *m_Current != '"' || !parseString(key))
+					return false;
+				skipWhitespace();
+				if (m_Current >= m_End || *m_Current++ != ':')
+					return false;
+				value.object.emplace_back(std::move(key), JsonValue());
+				if (!parseValue(value.object.back().second, depth + 1))
+					return false;
+				skipWhitespace();
+				if (m_Current >= m_End)
+					return false;
+				const char separator = *m_Current++;
+				if (separator == '}')
+					return true;
+				if (separator != ',')
+					return false;
+			}
+		}
+
+		bool parseArray(JsonValue& value, int depth)
+		{
+			value.type = JsonValue::Array;
+			m_Current++;
+			skipWhitespace();
+			if (m_Current < m_End && *m_Current == ']')
+				return ++m_Current, true;
+			for (;;)
+			{
+				value.array.emplace_back();
+				if (!parseValue(value.array.back(), depth + 1))
+					return false;
+				skipWhitespace();
+				if (m_Current >= m_End)
+					return false;
+				const char separator = *m_Current++;
+				if (separator == ']')
+					return true;
+				if (separator != ',')
+					return false;
+			}
+		}
+
+		bool parseString(std::string& out)
+		{
+			m_Current++;
+			while (m_Current < m_End && *m_Current != '"')
+			{
+				char c = *m_Current++;
+				if (c != '\\')
+				{
+					out += c;
+					continue;
+				}
+				if (m_Current >= m_End)
+					return false;
+				c = *m_Current++;
+				switch (c)
+				{
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					// surrogate pairs are kept as two code points, names and URIs don't need more
+					if (m_End - m_Current < 4)
+						return false;
+					const unsigned int code = static_cast<unsigned int>(std::strtoul(std::string(m_Current, 4).c_str(), nullptr, 16));
+					m_Current += 4;
+					if (code < 0x80)
+						out += static_cast<char>(code);
+					else if (code < 0x800)
+					{
+						out += static_cast<char>(0xC0 | code >> 6);
+						out += static_cast<char>(0x80 | (code & 0x3F));
+					}
+					else
+					{
+						out += static_cast<char>(0xE0 | code >> 12);
+						out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+						out += static_cast<char>(0x80 | (code & 0x3F));
+					}
+					break;
+				}
+				default: out += c; break; // \" \\ \/
+				}
+			}
+			if (m_Current >= m_End)
+				return false;
+			m_Current++;
+			return true;
+		}
+
+		bool parseNumber(JsonValue& value)
+		{
+			// copied out so strtod can't run past the end of the mapping
+			char text[64];
+			size_t length = 0;
+			while (m_Current + length < m_End && length < sizeof(text) - 1 && std::strchr("+-0123456789.eE", m_Current[length]))
+				length++;
+			if (length == 0)
+				return false;
+			std::memcpy(text, m_Current, length);
+			text[length] = '\0';
+			value.type = JsonValue::Number;
+			value.number = std::strtod(text, nullptr);
+			m_Current += length;
+			return true;
+		}
+
+		const char* m_Current;
+		const char* m_End;
+	};
+
+	inline std::vector<unsigned char> decodeBase64(const char* text, size_t length)
+	{
+		std::vector<unsigned char> out;
+		out.reserve(length * 3 / 4);
+		unsigned int bits = 0;
+		int count = 0;
+		for (size_t i = 0; i < length && text[i] != '='; i++)
+		{
+			const char c = text[i];
+			int value;
+			if (c >= 'A' && c <= 'Z') value = c - 'A';
+			else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+			else if (c >= '0' && c <= '9') value = c - '0' + 52;
+			else if (c == '+') value = 62;
+			else if (c == '/') value = 63;
+			else continue;
+			bits = bits << 6 | value;
+			if ((count += 6) >= 8)
+			{
+				count -= 8;
+				out.push_back(static_cast<unsigned char>(bits >> count));
+			}
+		}
+		return out;
+	}
+
+	// stb_image only has a global setter for flipping; decoding a 1x2 image tells which way it is set
+	inline bool stbiFlipsOnLoad()
+	{
+		static const unsigned char probe[] = { 'P', '5', '\n', '1', ' ', '2', '\n', '2', '5', '5', '\n', 0, 255 };
+		int width, height, components;
+		unsigned char* pixels = stbi_load_from_memory(probe, sizeof(probe), &width, &height, &components, 1);
+		const bool flipped = pixels && pixels[0] == 255;
+		stbi_image_free(pixels);
+		return flipped;
+	}
+
+	inline size_t componentSize(GLenum componentType)
+	{
+		return componentType == GL_BYTE || componentType == GL_UNSIGNED_BYTE ? 1
+			: componentType == GL_SHORT || componentType == GL_UNSIGNED_SHORT ? 2 : 4;
+	}
+
+	inline int componentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4" || type == "MAT2") return 4;
+		if (type == "MAT3") return 9;
+		if (type == "MAT4") return 16;
+		return 0;
+	}
+}
+
+// Loads glTF 2.0 (.gltf with external or embedded buffers, and .glb) without Assimp. Buffers are memory-mapped and
+// every bufferView used by a primitive goes to glBufferData straight from the mapping; accessors become attribute
+// pointers into those buffers (same locations as Mesh::setupMesh), so vertices are never copied or converted on the CPU.
+// Skin joints get bone ids equal to their index in the skin, so JOINTS_0 feeds the bone palette as is, and
+// animations are decoded into the engine's Bone keys and node hierarchy for Animator.
+// Meshes keep their node transform in meshTransforms; Draw(shader, model) applies it.
+class GltfModel
+{
+public:
+	vector<Texture> textures_loaded;
+	vector<Mesh>    meshes;
+	// node transform of each mesh, identity for skinned meshes (their joints place them)
+	vector<glm::mat4> meshTransforms;
+	vector<Animation> animations;
+	vector<string> animationNames;
+	string directory;
+	// object-space bounds of all meshes with their node transforms
+	glm::vec3 aabbMin = glm::vec3(0.0f);
+	glm::vec3 aabbMax = glm::vec3(0.0f);
+	glm::vec3 sphereCenter = glm::vec3(0.0f);
+	float sphereRadius = 0.0f;
+
+	// expects a .gltf or .glb path; check IsLoaded() afterwards
+	explicit GltfModel(string const &path)
+	{
+		loaded = loadModel(path);
+	}
+
+	bool IsLoaded() const { return loaded; }
+
+	// draws every mesh with its node transform applied after model
+	void Draw(Shader &shader, const glm::mat4 &model)
+	{
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			shader.setMat4("model", model * meshTransforms[i]);
+			meshes[i].Draw(shader);
+		}
+	}
+
+	// nullptr when there is no clip of that name
+	Animation* FindAnimation(const string &name)
+	{
+		for (size_t i = 0; i < animationNames.size(); i++)
+		{
+			if (animationNames[i] == name)
+				return &animations[i];
+		}
+		return nullptr;
+	}
+
+	auto& GetBoneInfoMap() { return m_BoneInfoMap; }
+	int& GetBoneCount() { return m_BoneCounter; }
+	const AssimpNodeData& GetRootNode() const { return m_RootNode; }
+
+private:
+	typedef gltf_detail::JsonValue JsonValue;
+
+	struct BufferData
+	{
+		const unsigned char* data = nullptr;
+		size_t size = 0;
+	};
+
+	struct Accessor
+	{
+		const unsigned char* data = nullptr; // first element
+		size_t offset = 0;                   // of the first element inside its bufferView
+		int view = -1;
+		size_t count = 0;
+		size_t stride = 0;
+		GLenum componentType = GL_FLOAT;
+		int components = 0;
+		bool normalized = false;
+	};
+
+	bool loaded = false;
+	std::map<std::string, BoneInfo> m_BoneInfoMap;
+	int m_BoneCounter = 0;
+	AssimpNodeData m_RootNode;
+
+	// alive while loading only, GL has its own copy of the buffers afterwards
+	JsonValue document;
+	vector<std::unique_ptr<gltf_detail::MappedFile>> mappedFiles;
+	vector<vector<unsigned char>> decodedBuffers;
+	vector<BufferData> buffers;
+	vector<unsigned int> viewBuffers; // GL buffer of each bufferView, 0 until a primitive uses it
+	unsigned int unskinnedBuffer = 0; // one ivec4(-1) + vec4(0) shared by the primitives without a skin
+	vector<string> nodeNames;
+	vector<int> imageTextures;        // index into textures_loaded per image, -1 until loaded
+
+	bool loadModel(const string &path)
+	{
+		directory = path.substr(0, path.find_last_of('/'));
+		if (!parseFile(path) || !loadBuffers())
+			return false;
+
+		nodeNames.resize(document["nodes"].size());
+		for (size_t i = 0; i < nodeNames.size(); i++)
+		{
+			// unique names, the skeleton and the clips look nodes up by name
+			nodeNames[i] = document["nodes"][i]["name"].string;
+			if (nodeNames[i].empty() || std::find(nodeNames.begin(), nodeNames.begin() + i, nodeNames[i]) != nodeNames.begin() + i)
+				nodeNames[i] += "#node" + std::to_string(i);
+		}
+		viewBuffers.assign(document["bufferViews"].size(), 0);
+		imageTextures.assign(document["images"].size(), -1);
+
+		loadSkin();
+		const JsonValue &scene = document["scenes"][static_cast<size_t>(document["scene"].asInt(0))];
+		m_RootNode.name = "";
+		m_RootNode.transformation = glm::mat4(1.0f);
+		for (const JsonValue &root : scene["nodes"].array)
+		{
+			AssimpNodeData child;
+			processNode(root.asInt(), glm::mat4(1.0f), child);
+			m_RootNode.children.push_back(std::move(child));
+		}
+		m_RootNode.childrenCount = static_cast<int>(m_RootNode.children.size());
+
+		for (size_t i = 0; i < document["animations"].size(); i++)
+			loadAnimation(document["animations"][i]);
+
+		computeBounds();
+
+		// drop the mappings and parsed JSON
+		document = JsonValue();
+		mappedFiles.clear();
+		decodedBuffers.clear();
+		buffers.clear();
+		return !meshes.empty() || !animations.empty();
+	}
+
+	bool parseFile(const string &path)
+	{
+		auto file = std::make_unique<gltf_detail::MappedFile>();
+		if (!file->open(path))
+		{
+			cout << "ERROR::GLTF:: could not open " << path << endl;
+			return false;
+		}
+		const unsigned char *data = file->data();
+		const char *jsonBegin = reinterpret_cast<const char*>(data), *jsonEnd = jsonBegin + file->size();
+
+		// GLB: 12 byte header, then a JSON chunk and an optional BIN chunk, chunks 4 byte aligned
+		BufferData binChunk;
+		if (file->size() >= 20 && std::memcmp(data, "glTF", 4) == 0)
+		{
+			uint32_t length, chunkLength, chunkType;
+			std::memcpy(&length, data + 8, 4);
+			std::memcpy(&chunkLength, data + 12, 4);
+			std::memcpy(&chunkType, data + 16, 4);
+			length = std::min<uint32_t>(length, static_cast<uint32_t>(file->size()));
+			if (chunkType != 0x4E4F534A || 20 + static_cast<size_t>(chunkLength) > length) // "JSON"
+			{
+				cout << "ERROR::GLTF:: malformed GLB " << path << endl;
+				return false;
+			}
+			jsonBegin = reinterpret_cast<const char*>(data + 20);
+			jsonEnd = jsonBegin + chunkLength;
+			const size_t binOffset = 20 + ((static_cast<size_t>(chunkLength) + 3) & ~static_cast<size_t>(3));
+			if (binOffset + 8 <= length)
+			{
+				uint32_t binLength, binType;
+				std::memcpy(&binLength, data + binOffset, 4);
+				std::memcpy(&binType, data + binOffset + 4, 4);
+				if (binType == 0x004E4942 && binOffset + 8 + binLength <= length) // "BIN\0"
+					binChunk = { data + binOffset + 8, binLength };
+			}
+		}
+
+		gltf_detail::JsonParser parser(jsonBegin, jsonEnd);
+		if (!parser.parse(document) || document.type != JsonValue::Object)
+		{
+			cout << "ERROR::GLTF:: invalid JSON in " << path << endl;
+			return false;
+		}
+		if (document["asset"]["version"].string.compare(0, 2, "2.") != 0)
+		{
+			cout << "ERROR::GLTF:: only glTF 2.0 is supported: " << path << endl;
+			return false;
+		}
+		for (const JsonValue &extension : document["extensionsRequired"].array)
+			cout << "WARNING::GLTF:: required extension " << extension.string << " is not supported" << endl;
+
+		mappedFiles.push_back(std::move(file));
+		buffers.push_back(binChunk); // slot 0 is the GLB chunk, buffers without uri refer to it
+		return true;
+	}
+
+	bool loadBuffers()
+	{
+		const BufferData binChunk = buffers[0];
+		buffers.clear();
+		for (const JsonValue &buffer : document["buffers"].array)
+		{
+			const string &uri = buffer["uri"].string;
+			BufferData data;
+			if (uri.empty())
+				data = binChunk;
+			else if (uri.compare(0, 5, "data:") == 0)
+			{
+				const size_t comma = uri.find(',');
+				decodedBuffers.push_back(gltf_detail::decodeBase64(uri.c_str() + comma + 1, comma == string::npos ? 0 : uri.size() - comma - 1));
+				data = { decodedBuffers.back().data(), decodedBuffers.back().size() };
+			}
+			else
+			{
+				auto file = std::make_unique<gltf_detail::MappedFile>();
+				if (file->open(directory + '/' + uri))
+					data = { file->data(), file->size() };
+				mappedFiles.push_back(std::move(file));
+			}
+
+			const size_t byteLength = static_cast<size_t>(buffer["byteLength"].number);
+			if (!data.data || data.size < byteLength)
+			{
+				cout << "ERROR::GLTF:: buffer " << (uri.empty() ? string("(GLB)") : uri.substr(0, 64)) << " is missing or too short" << endl;
+				return false;
+			}
+			data.size = byteLength;
+			buffers.push_back(data);
+		}
+		return true;
+	}
+
+	// element i of an accessor starts at accessor.data + i * accessor.stride; data is null when out of bounds
+	Accessor getAccessor(int index) const
+	{
+		Accessor result;
+		const JsonValue &accessor = document["accessors"][static_cast<size_t>(index)];
+		result.componentType = static_cast<GLenum>(accessor["componentType"].asInt(GL_FLOAT));
+		result.components = gltf_detail::componentCount(accessor["type"].string);
+		result.count = static_cast<size_t>(accessor["count"].number);
+		result.normalized = accessor["normalized"].asBool();
+		result.view = accessor["bufferView"].asInt(-1);
+		const size_t elementSize = gltf_detail::componentSize(result.componentType) * result.components;
+		if (result.view < 0 || accessor.has("sparse") || elementSize == 0)
+			return result;
+
+		const JsonValue &view = document["bufferViews"][static_cast<size_t>(result.view)];
+		const size_t bufferIndex = static_cast<size_t>(view["buffer"].asInt());
+		if (bufferIndex >= buffers.size())
+			return result;
+		const size_t viewOffset = static_cast<size_t>(view["byteOffset"].number);
+		const size_t viewLength = static_cast<size_t>(view["byteLength"].number);
+		result.offset = static_cast<size_t>(accessor["byteOffset"].number);
+		result.stride = view.has("byteStride") ? static_cast<size_t>(view["byteStride"].number) : elementSize;
+		if (viewOffset + viewLength > buffers[bufferIndex].size ||
+			(result.count > 0 && result.offset + (result.count - 1) * result.stride + elementSize > viewLength))
+			return result;
+		result.data = buffers[bufferIndex].data + viewOffset + result.offset;
+		return result;
+	}
+
+	// component c of element i as float, normalized integers mapped to [0, 1] / [-1, 1]
+	static float readFloat(const Accessor &accessor, size_t i, int c)
+	{
+		const unsigned char *p = accessor.data + i * accessor.stride + c * gltf_detail::componentSize(accessor.componentType);
+		switch (accessor.componentType)
+		{
+		case GL_FLOAT: { float v; std::memcpy(&v, p, 4); return v; }
+		case GL_UNSIGNED_BYTE: return accessor.normalized ? *p / 255.0f : *p;
+		case GL_BYTE: return accessor.normalized ? std::max(*reinterpret_cast<const int8_t*>(p) / 127.0f, -1.0f) : *reinterpret_cast<const int8_t*>(p);
+		case GL_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, p, 2); return accessor.normalized ? v / 65535.0f : v; }
+		case GL_SHORT: { int16_t v; std::memcpy(&v, p, 2); return accessor.normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+		default: { uint32_t v; std::memcpy(&v, p, 4); return static_cast<float>(v); }
+		}
+	}
+
+	// the GL buffer of a bufferView, uploaded on first use straight from the mapped file
+	unsigned int viewBuffer(int view, GLenum target)
+	{
+		if (viewBuffers[view])
+			return viewBuffers[view];
+		const JsonValue &bufferView = document["bufferViews"][static_cast<size_t>(view)];
+		const BufferData &buffer = buffers[static_cast<size_t>(bufferView["buffer"].asInt())];
+		glGenBuffers(1, &viewBuffers[view]);
+		glBindBuffer(target, viewBuffers[view]);
+		glBufferData(target, static_cast<GLsizeiptr>(bufferView["byteLength"].number), buffer.data + static_cast<size_t>(bufferView["byteOffset"].number), GL_STATIC_DRAW);
+		return viewBuffers[view];
+	}
+
+	glm::mat4 localTransform(const JsonValue &node) const
+	{
+		if (node.has("matrix"))
+		{
+			glm::mat4 matrix;
+			for (int i = 0; i < 16; i++)
+				glm::value_ptr(matrix)[i] = node["matrix"][i].asFloat(i % 5 == 0 ? 1.0f : 0.0f); // column major, like glm
+			return matrix;
+		}
+		const JsonValue &t = node["translation"], &r = node["rotation"], &s = node["scale"];
+		const glm::vec3 translation(t[0].asFloat(), t[1].asFloat(), t[2].asFloat());
+		const glm::quat rotation(r[3].asFloat(1.0f), r[0].asFloat(), r[1].asFloat(), r[2].asFloat());
+		const glm::vec3 scale(s[0].asFloat(1.0f), s[1].asFloat(1.0f), s[2].asFloat(1.0f));
+		return glm::translate(glm::mat4(1.0f), translation) * glm::toMat4(rotation) * glm::scale(glm::mat4(1.0f), scale);
+	}
+
+	// Joint i of the skin gets bone id i, which is what JOINTS_0 stores. Ids are per skin, so only the first
+	// skin is used; files where meshes use different skins would need their joint indices remapped.
+	void loadSkin()
+	{
+		const JsonValue &skins = document["skins"];
+		if (skins.size() == 0)
+			return;
+		for (size_t i = 1; i < skins.size(); i++)
+		{
+			if (skins[i]["joints"].array.size() != skins[0]["joints"].array.size())
+				cout << "WARNING::GLTF:: only the first skin is supported, meshes using skin " << i << " may deform wrongly" << endl;
+		}
+
+		const JsonValue &skin = skins[0];
+		const Accessor inverseBind = skin.has("inverseBindMatrices") ? getAccessor(skin["inverseBindMatrices"].asInt()) : Accessor();
+		for (size_t i = 0; i < skin["joints"].size(); i++)
+		{
+			const size_t node = static_cast<size_t>(skin["joints"][i].asInt());
+			if (node >= nodeNames.size())
+				continue;
+			BoneInfo info;
+			info.id = static_cast<int>(i);
+			info.offset = glm::mat4(1.0f);
+			if (inverseBind.data && i < inverseBind.count && inverseBind.components == 16)
+			{
+				for (int c = 0; c < 16; c++)
+					glm::value_ptr(info.offset)[c] = readFloat(inverseBind, i, c);
+			}
+			m_BoneInfoMap[nodeNames[node]] = info;
+		}
+		m_BoneCounter = static_cast<int>(skin["joints"].size());
+	}
+
+	void processNode(int index, const glm::mat4 &parentTransform, AssimpNodeData &dest)
+	{
+		const JsonValue &node = document["nodes"][static_cast<size_t>(index)];
+		dest.name = nodeNames[index];
+		dest.transformation = localTransform(node);
+		const glm::mat4 transform = parentTransform * dest.transformation;
+
+		if (node.has("mesh"))
+		{
+			const JsonValue &mesh = document["meshes"][static_cast<size_t>(node["mesh"].asInt())];
+			for (const JsonValue &primitive : mesh["primitives"].array)
+				processPrimitive(primitive, node.has("skin") ? glm::mat4(1.0f) : transform);
+		}
+
+		for (const JsonValue &child : node["children"].array)
+		{
+			AssimpNodeData childData;
+			processNode(child.asInt(), transform, childData);
+			dest.children.push_back(std::move(childData));
+		}
+		dest.childrenCount = static_cast<int>(dest.children.size());
+	}
+
+	void processPrimitive(const JsonValue &primitive, const glm::mat4 &transform)
+	{
+		if (primitive["mode"].asInt(GL_TRIANGLES) != GL_TRIANGLES)
+		{
+			cout << "WARNING::GLTF:: skipping a primitive that isn't a triangle list" << endl;
+			return;
+		}
+		const JsonValue &attributes = primitive["attributes"];
+		const Accessor position = getAccessor(attributes["POSITION"].asInt(-1));
+		if (!position.data || position.componentType != GL_FLOAT || position.components != 3)
+		{
+			cout << "WARNING::GLTF:: skipping a primitive without usable positions" << endl;
+			return;
+		}
+
+		unsigned int VAO;
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+
+		// same locations as Mesh::setupMesh; vec4 tangents feed the vec3 attribute (w is the handedness)
+		static const struct { const char *name; unsigned int location; int maxComponents; bool integer; } slots[] = {
+			{ "POSITION", 0, 3, false }, { "NORMAL", 1, 3, false }, { "TEXCOORD_0", 2, 2, false },
+			{ "TANGENT", 3, 3, false }, { "JOINTS_0", 5, 4, true }, { "WEIGHTS_0", 6, 4, false } };
+		int skinAttributes = 0;
+		for (const auto &slot : slots)
+		{
+			if (!attributes.has(slot.name))
+				continue;
+			const Accessor accessor = getAccessor(attributes[slot.name].asInt());
+			if (!accessor.data)
+			{
+				cout << "WARNING::GLTF:: attribute " << slot.name << " is sparse or out of bounds, skipped" << endl;
+				continue;
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, viewBuffer(accessor.view, GL_ARRAY_BUFFER));
+			glEnableVertexAttribArray(slot.location);
+			const GLint size = std::min(accessor.components, slot.maxComponents);
+			if (slot.integer)
+				glVertexAttribIPointer(slot.location, size, accessor.componentType, static_cast<GLsizei>(accessor.stride), (void*)accessor.offset);
+			else
+				glVertexAttribPointer(slot.location, size, accessor.componentType, accessor.normalized ? GL_TRUE : GL_FALSE, static_cast<GLsizei>(accessor.stride), (void*)accessor.offset);
+			skinAttributes += slot.location == 5 || slot.location == 6;
+		}
+		// The skinning shaders read ivec4 boneIds, and the default of a disabled attribute is a float (0, 0, 0, 1),
+		// which is undefined as integers. Unskinned primitives get id -1 and weight 0 for every vertex instead.
+		if (skinAttributes != 2)
+			bindUnskinnedAttributes();
+
+		GLenum indexType = GL_UNSIGNED_INT;
+		unsigned int firstIndex = 0, indexCount = 0;
+		const Accessor indices = primitive.has("indices") ? getAccessor(primitive["indices"].asInt()) : Accessor();
+		if (indices.data)
+		{
+			// the view's buffer is bound as the VAO's element array as is, only the start moves
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, viewBuffer(indices.view, GL_ELEMENT_ARRAY_BUFFER));
+			indexType = indices.componentType;
+			firstIndex = static_cast<unsigned int>(indices.offset / gltf_detail::componentSize(indexType));
+			indexCount = static_cast<unsigned int>(indices.count);
+		}
+		else
+		{
+			// non-indexed primitive: Mesh always draws elements, so this is the one place that builds data
+			vector<unsigned int> sequence(position.count);
+			for (size_t i = 0; i < sequence.size(); i++)
+				sequence[i] = static_cast<unsigned int>(i);
+			unsigned int EBO;
+			glGenBuffers(1, &EBO);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sequence.size() * sizeof(unsigned int), sequence.data(), GL_STATIC_DRAW);
+			indexCount = static_cast<unsigned int>(sequence.size());
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// glTF requires min/max on positions, scan the mapped data if a writer left them out
+		const JsonValue &positionAccessor = document["accessors"][static_cast<size_t>(attributes["POSITION"].asInt())];
+		glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(std::numeric_limits<float>::lowest());
+		if (positionAccessor["min"].size() == 3 && positionAccessor["max"].size() == 3)
+		{
+			boundsMin = glm::vec3(positionAccessor["min"][0].asFloat(), positionAccessor["min"][1].asFloat(), positionAccessor["min"][2].asFloat());
+			boundsMax = glm::vec3(positionAccessor["max"][0].asFloat(), positionAccessor["max"][1].asFloat(), positionAccessor["max"][2].asFloat());
+		}
+		else
+		{
+			for (size_t i = 0; i < position.count; i++)
+			{
+				const glm::vec3 p(readFloat(position, i, 0), readFloat(position, i, 1), readFloat(position, i, 2));
+				boundsMin = glm::min(boundsMin, p);
+				boundsMax = glm::max(boundsMax, p);
+			}
+		}
+
+		meshes.push_back(Mesh(VAO, indexType, firstIndex, indexCount, boundsMin, boundsMax, loadMaterialTextures(primitive["material"].asInt(-1))));
+		meshTransforms.push_back(transform);
+	}
+
+	// bone ids and weights of the bound VAO from a single element, repeated for every vertex through the divisor.
+	// The divisor is as large as it gets rather than 1, so instanced draws (RenderQueue) stay on that element too.
+	void bindUnskinnedAttributes()
+	{
+		const GLuint everyInstance = 0xFFFFFFFFu;
+		if (!unskinnedBuffer)
+		{
+			struct { GLint ids[4]; float weights[4]; } unskinned = { { -1, -1, -1, -1 }, { 0.0f, 0.0f, 0.0f, 0.0f } };
+			glGenBuffers(1, &unskinnedBuffer);
+			glBindBuffer(GL_ARRAY_BUFFER, unskinnedBuffer);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(unskinned), &unskinned, GL_STATIC_DRAW);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, unskinnedBuffer);
+		glEnableVertexAttribArray(5);
+		glVertexAttribIPointer(5, 4, GL_INT, 0, (void*)0);
+		glVertexAttribDivisor(5, everyInstance);
+		glEnableVertexAttribArray(6);
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, 0, (void*)(4 * sizeof(GLint)));
+		glVertexAttribDivisor(6, everyInstance);
+	}
+
+	// base colour as texture_diffuse1 and the normal map as texture_normal1, the names Mesh::BindTextures uses
+	vector<Texture> loadMaterialTextures(int materialIndex)
+	{
+		vector<Texture> textures;
+		if (materialIndex < 0)
+			return textures;
+		const JsonValue &material = document["materials"][static_cast<size_t>(materialIndex)];
+		const std::pair<const JsonValue*, const char*> maps[] = {
+			{ &material["pbrMetallicRoughness"]["baseColorTexture"], "texture_diffuse" },
+			{ &material["normalTexture"], "texture_normal" } };
+		for (const auto &map : maps)
+		{
+			if (!map.first->has("index"))
+				continue;
+			const JsonValue &texture = document["textures"][static_cast<size_t>(map.first->operator[]("index").asInt())];
+			const int image = texture["source"].asInt(-1);
+			if (image < 0 || static_cast<size_t>(image) >= imageTextures.size())
+				continue;
+			if (imageTextures[image] < 0)
+			{
+				Texture loadedTexture;
+				loadedTexture.id = loadImage(document["images"][static_cast<size_t>(image)], document["samplers"][static_cast<size_t>(texture["sampler"].asInt(-1))]);
+				loadedTexture.type = map.second;
+				loadedTexture.path = document["images"][static_cast<size_t>(image)]["uri"].string;
+				if (!loadedTexture.id)
+					continue;
+				imageTextures[image] = static_cast<int>(textures_loaded.size());
+				textures_loaded.push_back(loadedTexture);
+			}
+			Texture result = textures_loaded[imageTextures[image]];
+			result.type = map.second;
+			textures.push_back(result);
+		}
+		return textures;
+	}
+
+	// decodes from the mapped file or buffer view; glTF's uv origin is the image's top-left, so rows stay top-down
+	unsigned int loadImage(const JsonValue &image, const JsonValue &sampler)
+	{
+		const unsigned char *bytes = nullptr;
+		size_t size = 0;
+		gltf_detail::MappedFile file;
+		vector<unsigned char> decoded;
+		const string &uri = image["uri"].string;
+		if (image.has("bufferView"))
+		{
+			const JsonValue &view = document["bufferViews"][static_cast<size_t>(image["bufferView"].asInt())];
+			const size_t buffer = static_cast<size_t>(view["buffer"].asInt());
+			if (buffer < buffers.size() && static_cast<size_t>(view["byteOffset"].number + view["byteLength"].number) <= buffers[buffer].size)
+			{
+				bytes = buffers[buffer].data + static_cast<size_t>(view["byteOffset"].number);
+				size = static_cast<size_t>(view["byteLength"].number);
+			}
+		}
+		else if (uri.compare(0, 5, "data:") == 0)
+		{
+			const size_t comma = uri.find(',');
+			if (comma != string::npos)
+				decoded = gltf_detail::decodeBase64(uri.c_str() + comma + 1, uri.size() - comma - 1);
+			bytes = decoded.data();
+			size = decoded.size();
+		}
+		else if (file.open(directory + '/' + uri))
+		{
+			bytes = file.data();
+			size = file.size();
+		}
+
+		int width, height, nrComponents;
+		unsigned char *data = bytes ? stbi_load_from_memory(bytes, static_cast<int>(size), &width, &height, &nrComponents, 4) : nullptr;
+		if (!data)
+		{
+			std::cout << "Texture failed to load at path: " << (uri.empty() ? string("(embedded)") : uri.substr(0, 64)) << std::endl;
+			return 0;
+		}
+		if (gltf_detail::stbiFlipsOnLoad())
+		{
+			const size_t rowBytes = static_cast<size_t>(width) * 4;
+			for (int y = 0; y < height / 2; y++)
+				std::swap_ranges(data + y * rowBytes, data + (y + 1) * rowBytes, data + (height - 1 - y) * rowBytes);
+		}
+
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		stbi_image_free(data);
+
+		// the sampler's settings, TextureFromFile's where it has none
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler["wrapS"].asInt(GL_REPEAT));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler["wrapT"].asInt(GL_REPEAT));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler["minFilter"].asInt(GL_LINEAR_MIPMAP_LINEAR));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler["magFilter"].asInt(GL_LINEAR));
+		return textureID;
+	}
+
+	// One Bone per animated node with the clip's keys in seconds (ticks per second is 1). Nodes missing a path keep
+	// their rest value as a single key; STEP becomes pairs of keys and CUBICSPLINE uses its values only, since Bone
+	// interpolates linearly. Every list is padded to cover [0, duration] because Bone can't extrapolate.
+	void loadAnimation(const JsonValue &animation)
+	{
+		struct Channels
+		{
+			vector<KeyPosition> positions;
+			vector<KeyRotation> rotations;
+			vector<KeyScale> scales;
+		};
+		std::map<int, Channels> nodes;
+		float duration = 0.0f;
+
+		for (const JsonValue &channel : animation["channels"].array)
+		{
+			const int node = channel["target"]["node"].asInt(-1);
+			const string &path = channel["target"]["path"].string;
+			const JsonValue &sampler = animation["samplers"][static_cast<size_t>(channel["sampler"].asInt())];
+			const Accessor input = getAccessor(sampler["input"].asInt(-1));
+			const Accessor output = getAccessor(sampler["output"].asInt(-1));
+			if (node < 0 || static_cast<size_t>(node) >= nodeNames.size() || !input.data || !output.data || input.count == 0)
+				continue;
+			const string &interpolation = sampler["interpolation"].string;
+			const bool cubic = interpolation == "CUBICSPLINE";
+			const bool step = interpolation == "STEP";
+			// cubic splines store in-tangent, value, out-tangent per key
+			const size_t valueOffset = cubic ? 1 : 0, valueStride = cubic ? 3 : 1;
+			if (output.count < input.count * valueStride)
+				continue;
+
+			Channels &keys = nodes[node];
+			for (size_t i = 0; i < input.count; i++)
+			{
+				const float time = readFloat(input, i, 0);
+				duration = std::max(duration, time);
+				const size_t v = i * valueStride + valueOffset;
+				// STEP: hold the previous value until just before this key
+				const bool hold = step && i > 0;
+				const size_t previous = (i - (hold ? 1 : 0)) * valueStride + valueOffset;
+				const float holdTime = hold ? time - 1e-4f * (time - readFloat(input, i - 1, 0)) : time;
+				if (path == "translation")
+				{
+					if (hold)
+						keys.positions.push_back({ glm::vec3(readFloat(output, previous, 0), readFloat(output, previous, 1), readFloat(output, previous, 2)), holdTime });
+					keys.positions.push_back({ glm::vec3(readFloat(output, v, 0), readFloat(output, v, 1), readFloat(output, v, 2)), time });
+				}
+				else if (path == "rotation")
+				{
+					if (hold)
+						keys.rotations.push_back({ glm::quat(readFloat(output, previous, 3), readFloat(output, previous, 0), readFloat(output, previous, 1), readFloat(output, previous, 2)), holdTime });
+					keys.rotations.push_back({ glm::quat(readFloat(output, v, 3), readFloat(output, v, 0), readFloat(output, v, 1), readFloat(output, v, 2)), time });
+				}
+				else if (path == "scale")
+				{
+					if (hold)
+						keys.scales.push_back({ glm::vec3(readFloat(output, previous, 0), readFloat(output, previous, 1), readFloat(output, previous, 2)), holdTime });
+					keys.scales.push_back({ glm::vec3(readFloat(output, v, 0), readFloat(output, v, 1), readFloat(output, v, 2)), time });
+				}
+			}
+		}
+		if (nodes.empty())
+			return;
+
+		vector<Bone> bones;
+		for (auto &entry : nodes)
+		{
+			const JsonValue &node = document["nodes"][static_cast<size_t>(entry.first)];
+			Channels &keys = entry.second;
+			const JsonValue &t = node["translation"], &r = node["rotation"], &s = node["scale"];
+			if (keys.positions.empty())
+				keys.positions.push_back({ glm::vec3(t[0].asFloat(), t[1].asFloat(), t[2].asFloat()), 0.0f });
+			if (keys.rotations.empty())
+				keys.rotations.push_back({ glm::quat(r[3].asFloat(1.0f), r[0].asFloat(), r[1].asFloat(), r[2].asFloat()), 0.0f });
+			if (keys.scales.empty())
+				keys.scales.push_back({ glm::vec3(s[0].asFloat(1.0f), s[1].asFloat(1.0f), s[2].asFloat(1.0f)), 0.0f });
+			padKeys(keys.positions, duration);
+			padKeys(keys.rotations, duration);
+			padKeys(keys.scales, duration);
+
+			const auto bone = m_BoneInfoMap.find(nodeNames[entry.first]);
+			bones.push_back(Bone(nodeNames[entry.first], bone == m_BoneInfoMap.end() ? -1 : bone->second.id,
+				std::move(keys.positions), std::move(keys.rotations), std::move(keys.scales)));
+		}
+
+		animations.push_back(Animation(duration, 1, m_RootNode, std::move(bones), m_BoneInfoMap));
+		animationNames.push_back(animation["name"].string);
+	}
+
+	// keys at 0 and past the duration, so every time Animator asks for falls between two keys
+	template<typename Key>
+	static void padKeys(vector<Key> &keys, float duration)
+	{
+		if (keys.size() == 1)
+			return;
+		if (keys.front().timeStamp > 0.0f)
+		{
+			Key first = keys.front();
+			first.timeStamp = 0.0f;
+			keys.insert(keys.begin(), first);
+		}
+		Key last = keys.back();
+		last.timeStamp = duration + 1.0f;
+		keys.push_back(last);
+	}
+
+	void computeBounds()
+	{
+		if (meshes.empty())
+			return;
+		aabbMin = glm::vec3(std::numeric_limits<float>::max());
+		aabbMax = glm::vec3(std::numeric_limits<float>::lowest());
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			// transformed corners of each mesh box
+			for (int corner = 0; corner < 8; corner++)
+			{
+				const glm::vec3 p((corner & 1) ? meshes[i].aabbMax.x : meshes[i].aabbMin.x,
+					(corner & 2) ? meshes[i].aabbMax.y : meshes[i].aabbMin.y,
+					(corner & 4) ? meshes[i].aabbMax.z : meshes[i].aabbMin.z);
+				const glm::vec3 world = glm::vec3(meshTransforms[i] * glm::vec4(p, 1.0f));
+				aabbMin = glm::min(aabbMin, world);
+				aabbMax = glm::max(aabbMax, world);
+			}
+		}
+		sphereCenter = (aabbMin + aabbMax) * 0.5f;
+		sphereRadius = glm::length(aabbMax - sphereCenter);
+	}
+};
+#endif
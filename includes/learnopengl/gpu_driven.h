@@ -0,0 +1,370 @@
+#ifndef GPU_DRIVEN_H
+#define GPU_DRIVEN_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum_culler.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_c.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// layout fixed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+struct GpuDrivenStats
+{
+	unsigned int meshes = 0;
+	unsigned int instances = 0;
+	unsigned int commands = 0;
+	unsigned int multiDrawCalls = 0;    // per draw(), one per material batch
+	unsigned int uploadedInstances = 0; // per cull(), transforms changed since the last one
+};
+
+// a model's meshes, added consecutively by addModel
+struct GpuModelHandle
+{
+	unsigned int firstMesh = 0;
+	unsigned int meshCount = 0;
+};
+
+// GPU-driven submission: all geometry in one vertex/index buffer, instances and mesh bounds in SSBOs,
+// frustum culling in a compute shader (gpu_cull.cs) that fills one DrawElementsIndirectCommand per mesh.
+// The scene then draws with one glMultiDrawElementsIndirect per material, so the CPU cost of a frame
+// doesn't depend on the number of instances, only on the number of transforms that changed.
+// Needs GL 4.3; draw with gpu_driven.vs. All instances share the bone palette uniform like in RenderQueue.
+class GpuDrivenScene
+{
+public:
+	static bool isSupported() { return GLAD_GL_VERSION_4_3 != 0; }
+
+	explicit GpuDrivenScene(ComputeShader& cullShader) : m_CullShader(&cullShader) {}
+
+	~GpuDrivenScene()
+	{
+		releaseBuffers();
+	}
+
+	GpuDrivenScene(const GpuDrivenScene&) = delete;
+	GpuDrivenScene& operator=(const GpuDrivenScene&) = delete;
+
+	// copies the mesh geometry into the shared buffers; textures are still read from mesh when drawing
+	unsigned int addMesh(const Mesh& mesh)
+	{
+		MeshRecord record;
+		record.source = &mesh;
+		record.firstIndex = static_cast<GLuint>(m_Indices.size());
+		record.indexCount = static_cast<GLuint>(mesh.indices.size());
+		record.baseVertex = static_cast<GLint>(m_Vertices.size());
+		record.center = mesh.GetAABBCenter();
+		record.extents = mesh.GetAABBExtents();
+		m_Vertices.insert(m_Vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+		m_Indices.insert(m_Indices.end(), mesh.indices.begin(), mesh.indices.end());
+		m_Meshes.push_back(record);
+		m_NeedsBuild = true;
+		return static_cast<unsigned int>(m_Meshes.size()) - 1;
+	}
+
+	// any model with a public meshes array (Model from model.h or model_animation.h)
+	template<typename ModelType>
+	GpuModelHandle addModel(const ModelType& model)
+	{
+		GpuModelHandle handle;
+		handle.firstMesh = static_cast<unsigned int>(m_Meshes.size());
+		for (const Mesh& mesh : model.meshes)
+			addMesh(mesh);
+		handle.meshCount = static_cast<unsigned int>(model.meshes.size());
+		return handle;
+	}
+
+	unsigned int addInstance(unsigned int mesh, const glm::mat4& model)
+	{
+		GpuInstance instance;
+		instance.model = model;
+		instance.mesh = mesh;
+		m_Instances.push_back(instance);
+		m_NeedsBuild = true;
+		return static_cast<unsigned int>(m_Instances.size()) - 1;
+	}
+
+	// one instance per mesh of the model, returns the first; the others follow in mesh order
+	unsigned int addModelInstance(const GpuModelHandle& handle, const glm::mat4& model)
+	{
+		const unsigned int first = static_cast<unsigned int>(m_Instances.size());
+		for (unsigned int i = 0; i < handle.meshCount; i++)
+			addInstance(handle.firstMesh + i, model);
+		return first;
+	}
+
+	void setInstanceTransform(unsigned int instance, const glm::mat4& model)
+	{
+		m_Instances[instance].model = model;
+		m_DirtyBegin = std::min(m_DirtyBegin, instance);
+		m_DirtyEnd = std::max(m_DirtyEnd, instance + 1);
+	}
+
+	void setModelInstanceTransform(unsigned int firstInstance, const GpuModelHandle& handle, const glm::mat4& model)
+	{
+		for (unsigned int i = 0; i < handle.meshCount; i++)
+			setInstanceTransform(firstInstance + i, model);
+	}
+
+	// (re)creates the GPU buffers; called by cull() when meshes or instances were added
+	void build()
+	{
+		releaseBuffers();
+
+		// commands grouped by texture set so each material is one multi-draw
+		std::map<std::vector<unsigned int>, std::vector<unsigned int>> meshesByMaterial;
+		for (unsigned int m = 0; m < m_Meshes.size(); m++)
+		{
+			std::vector<unsigned int> textureIds;
+			for (const Texture& texture : m_Meshes[m].source->textures)
+				textureIds.push_back(texture.id);
+			meshesByMaterial[textureIds].push_back(m);
+		}
+
+		std::vector<GLuint> instancesPerMesh(m_Meshes.size(), 0);
+		for (const GpuInstance& instance : m_Instances)
+			instancesPerMesh[instance.mesh]++;
+
+		std::vector<DrawElementsIndirectCommand> commands;
+		std::vector<GpuMeshBounds> bounds(m_Meshes.size());
+		m_Batches.clear();
+		GLuint baseInstance = 0;
+		for (const auto& material : meshesByMaterial)
+		{
+			MaterialBatch batch;
+			batch.textureSource = m_Meshes[material.second.front()].source;
+			batch.firstCommand = static_cast<unsigned int>(commands.size());
+			for (unsigned int m : material.second)
+			{
+				const MeshRecord& record = m_Meshes[m];
+				bounds[m].center = glm::vec4(record.center, 0.0f);
+				bounds[m].extents = glm::vec4(record.extents, 0.0f);
+				bounds[m].command = static_cast<GLuint>(commands.size());
+				// instanceCount is filled by the compute shader
+				commands.push_back({ record.indexCount, 0, record.firstIndex, record.baseVertex, baseInstance });
+				baseInstance += instancesPerMesh[m];
+			}
+			batch.commandCount = static_cast<unsigned int>(commands.size()) - batch.firstCommand;
+			m_Batches.push_back(batch);
+		}
+		m_NumCommands = static_cast<unsigned int>(commands.size());
+
+		// shared geometry, same attribute layout as Mesh plus the visible instance index
+		glGenVertexArrays(1, &m_VAO);
+		glGenBuffers(1, &m_VBO);
+		glGenBuffers(1, &m_EBO);
+		glGenBuffers(1, &m_VisibleBuffer);
+		glBindVertexArray(m_VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+		glBufferData(GL_ARRAY_BUFFER, m_Vertices.size() * sizeof(Vertex), m_Vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_Indices.size() * sizeof(unsigned int), m_Indices.data(), GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+		glEnableVertexAttribArray(5);
+		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+		glEnableVertexAttribArray(6);
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+		// baseInstance of each command points this attribute at the mesh's range of the visible list
+		glBindBuffer(GL_ARRAY_BUFFER, m_VisibleBuffer);
+		glBufferData(GL_ARRAY_BUFFER, std::max<size_t>(1, m_Instances.size()) * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+		glEnableVertexAttribArray(VISIBLE_INSTANCE_LOCATION);
+		glVertexAttribIPointer(VISIBLE_INSTANCE_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+		glVertexAttribDivisor(VISIBLE_INSTANCE_LOCATION, 1);
+		glBindVertexArray(0);
+
+		m_InstanceBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, m_Instances.size() * sizeof(GpuInstance), m_Instances.data(), GL_DYNAMIC_DRAW);
+		m_MeshBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, bounds.size() * sizeof(GpuMeshBounds), bounds.data(), GL_STATIC_DRAW);
+		m_CommandTemplate = createBuffer(GL_COPY_READ_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_DRAW);
+		m_CommandBuffer = createBuffer(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_COPY);
+
+		m_DirtyBegin = static_cast<unsigned int>(m_Instances.size());
+		m_DirtyEnd = 0;
+		m_NeedsBuild = false;
+	}
+
+	// uploads changed transforms and runs the culling compute shader; a fixed number of GL calls
+	void cull(const glm::mat4& viewProjection)
+	{
+		if (m_NeedsBuild)
+			build();
+		m_Stats.meshes = static_cast<unsigned int>(m_Meshes.size());
+		m_Stats.instances = static_cast<unsigned int>(m_Instances.size());
+		m_Stats.commands = m_NumCommands;
+		m_Stats.uploadedInstances = 0;
+		if (m_Instances.empty() || m_NumCommands == 0)
+			return;
+
+		if (m_DirtyBegin < m_DirtyEnd)
+		{
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_InstanceBuffer);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, m_DirtyBegin * sizeof(GpuInstance), (m_DirtyEnd - m_DirtyBegin) * sizeof(GpuInstance), &m_Instances[m_DirtyBegin]);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			m_Stats.uploadedInstances = m_DirtyEnd - m_DirtyBegin;
+			m_DirtyBegin = static_cast<unsigned int>(m_Instances.size());
+			m_DirtyEnd = 0;
+		}
+
+		// instance counts back to zero
+		glBindBuffer(GL_COPY_READ_BUFFER, m_CommandTemplate);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_CommandBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_NumCommands * sizeof(DrawElementsIndirectCommand));
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		const FrustumPlanes frustum = FrustumPlanes::fromViewProjection(viewProjection);
+		m_CullShader->use();
+		glUniform4fv(glGetUniformLocation(m_CullShader->ID, "frustumPlanes"), 6, &frustum.planes[0].x);
+		glUniform1ui(glGetUniformLocation(m_CullShader->ID, "instanceCount"), static_cast<GLuint>(m_Instances.size()));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_InstanceBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_MeshBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_CommandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_VisibleBuffer);
+		glDispatchCompute((static_cast<GLuint>(m_Instances.size()) + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// shader is gpu_driven.vs based, used and with view/projection set by the caller like Entity::drawSelfAndChild
+	void draw(Shader& shader)
+	{
+		m_Stats.multiDrawCalls = 0;
+		if (m_Instances.empty() || m_NumCommands == 0)
+			return;
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_InstanceBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+		glBindVertexArray(m_VAO);
+		for (const MaterialBatch& batch : m_Batches)
+		{
+			batch.textureSource->BindTextures(shader);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+				(void*)(batch.firstCommand * sizeof(DrawElementsIndirectCommand)), batch.commandCount, 0);
+			m_Stats.multiDrawCalls++;
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	// reads the culled commands back; for debugging and stats only, it waits for the GPU
+	std::vector<DrawElementsIndirectCommand> readCommands() const
+	{
+		std::vector<DrawElementsIndirectCommand> commands(m_NumCommands);
+		if (m_NumCommands == 0)
+			return commands;
+		glBindBuffer(GL_COPY_READ_BUFFER, m_CommandBuffer);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		return commands;
+	}
+
+	const GpuDrivenStats& getStats() const { return m_Stats; }
+
+	static const GLuint VISIBLE_INSTANCE_LOCATION = 7;
+	static const GLuint CULL_GROUP_SIZE = 64; // local_size_x of gpu_cull.cs
+
+private:
+	// std430 layouts, see gpu_cull.cs
+	struct GpuInstance
+	{
+		glm::mat4 model;
+		GLuint mesh;
+		GLuint padding[3];
+	};
+
+	struct GpuMeshBounds
+	{
+		glm::vec4 center;
+		glm::vec4 extents;
+		GLuint command;
+		GLuint padding[3];
+	};
+
+	struct MeshRecord
+	{
+		const Mesh* source;
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+		glm::vec3 center;
+		glm::vec3 extents;
+	};
+
+	struct MaterialBatch
+	{
+		const Mesh* textureSource;
+		unsigned int firstCommand;
+		unsigned int commandCount;
+	};
+
+	static unsigned int createBuffer(GLenum target, size_t size, const void* data, GLenum usage)
+	{
+		unsigned int buffer;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(target, buffer);
+		// zero-sized stores aren't allowed to be bound as SSBOs
+		glBufferData(target, std::max<size_t>(size, 16), NULL, usage);
+		if (data && size)
+			glBufferSubData(target, 0, size, data);
+		glBindBuffer(target, 0);
+		return buffer;
+	}
+
+	void releaseBuffers()
+	{
+		const unsigned int buffers[] = { m_VBO, m_EBO, m_VisibleBuffer, m_InstanceBuffer, m_MeshBuffer, m_CommandTemplate, m_CommandBuffer };
+		for (unsigned int buffer : buffers)
+		{
+			if (buffer)
+				glDeleteBuffers(1, &buffer);
+		}
+		if (m_VAO)
+			glDeleteVertexArrays(1, &m_VAO);
+		m_VAO = m_VBO = m_EBO = m_VisibleBuffer = m_InstanceBuffer = m_MeshBuffer = m_CommandTemplate = m_CommandBuffer = 0;
+	}
+
+	ComputeShader* m_CullShader;
+
+	std::vector<Vertex> m_Vertices;
+	std::vector<unsigned int> m_Indices;
+	std::vector<MeshRecord> m_Meshes;
+	std::vector<GpuInstance> m_Instances;
+	std::vector<MaterialBatch> m_Batches;
+	unsigned int m_NumCommands = 0;
+	bool m_NeedsBuild = true;
+	unsigned int m_DirtyBegin = 0, m_DirtyEnd = 0;
+
+	unsigned int m_VAO = 0, m_VBO = 0, m_EBO = 0;
+	unsigned int m_VisibleBuffer = 0;
+	unsigned int m_InstanceBuffer = 0;
+	unsigned int m_MeshBuffer = 0;
+	unsigned int m_CommandTemplate = 0;
+	unsigned int m_CommandBuffer = 0;
+
+	GpuDrivenStats m_Stats;
+};
+#endif
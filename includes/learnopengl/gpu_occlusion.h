@@ -0,0 +1,256 @@
+#ifndef GPU_OCCLUSION_H
+#define GPU_OCCLUSION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <vector>
+
+enum OcclusionQueryMode
+{
+	// draw what was visible last time a result came back, query everything for the next frame
+	OCCLUSION_QUERY_PREVIOUS_FRAME,
+	// query right before the draw and let the GPU skip it with glBeginConditionalRender
+	OCCLUSION_QUERY_CONDITIONAL
+};
+
+struct OcclusionQueryStats
+{
+	unsigned int issued = 0;
+	unsigned int resultsRead = 0;   // results that were available in beginFrame()
+	unsigned int resultsPending = 0; // results still in flight in beginFrame(), kept for a later frame
+	unsigned int occluded = 0;      // read results with no samples passed
+	unsigned int cameraInside = 0;  // proxies skipped because the camera is inside the box
+};
+
+// Hardware occlusion queries on proxy boxes.
+// Entities keep a slot (Entity::occlusionQuery) that owns one query object. Proxy boxes are collected with
+// addProxy() and drawn in one batch by issueQueries() with color and depth writes off, so they only test
+// against whatever is already in the depth buffer. Results are polled in beginFrame() without ever waiting;
+// a slot whose result isn't back yet keeps its previous visibility (visible at first).
+// Uses GL_ANY_SAMPLES_PASSED_CONSERVATIVE on GL 4.3+ and GL_ANY_SAMPLES_PASSED otherwise.
+class OcclusionQueryCuller
+{
+public:
+	// proxyShader: occlusion_proxy.vs / occlusion_proxy.fs
+	OcclusionQueryCuller(Shader& proxyShader, OcclusionQueryMode mode = OCCLUSION_QUERY_PREVIOUS_FRAME)
+		: m_ProxyShader(&proxyShader), m_Mode(mode)
+	{
+		m_Target = GLAD_GL_VERSION_4_3 ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+		// unit cube, [-1, 1] on every axis, scaled by the box extents
+		const float vertices[] = {
+			-1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,   1.0f,  1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+			-1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f,   1.0f,  1.0f,  1.0f,  -1.0f,  1.0f,  1.0f
+		};
+		const unsigned int indices[] = {
+			0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,
+			0, 1, 5, 0, 5, 4,   3, 6, 2, 3, 7, 6,
+			0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5
+		};
+
+		glGenVertexArrays(1, &m_VAO);
+		glGenBuffers(1, &m_VBO);
+		glGenBuffers(1, &m_EBO);
+		glBindVertexArray(m_VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glBindVertexArray(0);
+	}
+
+	~OcclusionQueryCuller()
+	{
+		for (QuerySlot& slot : m_Slots)
+			glDeleteQueries(1, &slot.query);
+		glDeleteBuffers(1, &m_EBO);
+		glDeleteBuffers(1, &m_VBO);
+		glDeleteVertexArrays(1, &m_VAO);
+	}
+
+	OcclusionQueryCuller(const OcclusionQueryCuller&) = delete;
+	OcclusionQueryCuller& operator=(const OcclusionQueryCuller&) = delete;
+
+	void setMode(OcclusionQueryMode mode) { m_Mode = mode; }
+	OcclusionQueryMode getMode() const { return m_Mode; }
+
+	// picks up every result that is already available, then starts a new batch
+	void beginFrame(const glm::mat4& view, const glm::mat4& projection)
+	{
+		m_View = view;
+		m_Projection = projection;
+		m_CameraPosition = glm::vec3(glm::inverse(view)[3]);
+		m_Stats = OcclusionQueryStats();
+		m_Proxies.clear();
+
+		for (QuerySlot& slot : m_Slots)
+		{
+			slot.issuedThisFrame = false;
+			if (!slot.pending)
+				continue;
+
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+			{
+				m_Stats.resultsPending++;
+				continue;
+			}
+			GLuint samplesPassed = 0;
+			glGetQueryObjectuiv(slot.query, GL_QUERY_RESULT, &samplesPassed);
+			slot.visible = samplesPassed != 0;
+			slot.pending = false;
+			m_Stats.resultsRead++;
+			if (!slot.visible)
+				m_Stats.occluded++;
+		}
+	}
+
+	// returns slot when it is already valid, otherwise a new one
+	int acquire(int slot)
+	{
+		if (slot >= 0)
+			return slot;
+		if (!m_FreeSlots.empty())
+		{
+			slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+			m_Slots[slot] = QuerySlot{ m_Slots[slot].query };
+			return slot;
+		}
+		QuerySlot newSlot;
+		glGenQueries(1, &newSlot.query);
+		m_Slots.push_back(newSlot);
+		return static_cast<int>(m_Slots.size()) - 1;
+	}
+
+	void release(int slot)
+	{
+		if (slot >= 0)
+			m_FreeSlots.push_back(slot);
+	}
+
+	// last known result
+	bool isVisible(int slot) const
+	{
+		return m_Slots[slot].visible;
+	}
+
+	// queues the world AABB of slot's entity for the next issueQueries()
+	void addProxy(int slot, const glm::vec3& center, const glm::vec3& extents)
+	{
+		// in previous-frame mode a query still in flight is left alone so its result eventually arrives
+		if (m_Mode == OCCLUSION_QUERY_PREVIOUS_FRAME && m_Slots[slot].pending)
+			return;
+
+		// the near plane would cut the box open and the query could report nothing visible
+		const glm::vec3 margin = extents * 0.05f + glm::vec3(0.1f);
+		if (glm::all(glm::lessThanEqual(glm::abs(m_CameraPosition - center), extents + margin)))
+		{
+			m_Slots[slot].visible = true;
+			m_Stats.cameraInside++;
+			return;
+		}
+		m_Proxies.push_back({ slot, center, extents });
+	}
+
+	// draws all queued proxy boxes, one query each, with one program, VAO and state setup for the batch
+	void issueQueries()
+	{
+		if (m_Proxies.empty())
+			return;
+
+		GLboolean colorMask[4], depthMask;
+		glGetBooleanv(GL_COLOR_WRITEMASK, colorMask);
+		glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+		const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+		const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDepthMask(GL_FALSE);
+		glEnable(GL_DEPTH_TEST);
+		glDisable(GL_CULL_FACE);
+
+		m_ProxyShader->use();
+		m_ProxyShader->setMat4("view", m_View);
+		m_ProxyShader->setMat4("projection", m_Projection);
+		glBindVertexArray(m_VAO);
+		for (const Proxy& proxy : m_Proxies)
+		{
+			QuerySlot& slot = m_Slots[proxy.slot];
+			m_ProxyShader->setMat4("model", glm::scale(glm::translate(glm::mat4(1.0f), proxy.center), proxy.extents));
+			glBeginQuery(m_Target, slot.query);
+			glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+			glEndQuery(m_Target);
+			slot.pending = true;
+			slot.issuedThisFrame = true;
+			m_Stats.issued++;
+		}
+		glBindVertexArray(0);
+		m_Proxies.clear();
+
+		glColorMask(colorMask[0], colorMask[1], colorMask[2], colorMask[3]);
+		glDepthMask(depthMask);
+		if (!depthTest)
+			glDisable(GL_DEPTH_TEST);
+		if (cullFace)
+			glEnable(GL_CULL_FACE);
+	}
+
+	// wraps the entity's draw in conditional rendering on this frame's query. GL_QUERY_NO_WAIT draws anyway
+	// when the result isn't ready, so the GPU never stalls; slots without a query this frame just draw.
+	void beginConditional(int slot)
+	{
+		m_ConditionalActive = m_Slots[slot].issuedThisFrame;
+		if (m_ConditionalActive)
+			glBeginConditionalRender(m_Slots[slot].query, GL_QUERY_NO_WAIT);
+	}
+
+	void endConditional()
+	{
+		if (m_ConditionalActive)
+			glEndConditionalRender();
+		m_ConditionalActive = false;
+	}
+
+	const OcclusionQueryStats& getStats() const { return m_Stats; }
+
+private:
+	struct QuerySlot
+	{
+		GLuint query = 0;
+		bool pending = false;
+		bool visible = true;
+		bool issuedThisFrame = false;
+	};
+
+	struct Proxy
+	{
+		int slot;
+		glm::vec3 center;
+		glm::vec3 extents;
+	};
+
+	Shader* m_ProxyShader;
+	OcclusionQueryMode m_Mode;
+	GLenum m_Target;
+	unsigned int m_VAO = 0, m_VBO = 0, m_EBO = 0;
+
+	glm::mat4 m_View = glm::mat4(1.0f);
+	glm::mat4 m_Projection = glm::mat4(1.0f);
+	glm::vec3 m_CameraPosition = glm::vec3(0.0f);
+
+	std::vector<QuerySlot> m_Slots;
+	std::vector<int> m_FreeSlots;
+	std::vector<Proxy> m_Proxies;
+	bool m_ConditionalActive = false;
+
+	OcclusionQueryStats m_Stats;
+};
+#endif
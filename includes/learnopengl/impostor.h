@@ -0,0 +1,306 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+// Octahedral impostor of a model: framesPerSide x framesPerSide views of its bounding sphere, the view
+// direction of frame (x, y) being the octahedral decode of its grid position (see impostor.vs).
+// Albedo (alpha = coverage) and model-space normal are RGBA8, depth is the bake camera's depth buffer.
+struct ImpostorAtlas
+{
+	unsigned int albedo = 0;
+	unsigned int normal = 0;
+	unsigned int depth = 0;
+	int framesPerSide = 0;
+	int frameSize = 0;
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+
+	void release()
+	{
+		const unsigned int textures[] = { albedo, normal, depth };
+		for (unsigned int texture : textures)
+		{
+			if (texture)
+				glDeleteTextures(1, &texture);
+		}
+		albedo = normal = depth = 0;
+	}
+};
+
+// Renders a model into an ImpostorAtlas with impostor_bake.vs / impostor_bake.fs
+class ImpostorBaker
+{
+public:
+	explicit ImpostorBaker(Shader& bakeShader) : m_BakeShader(&bakeShader) {}
+
+	// around the model's bind-pose bounding sphere; palette is the pose to bake (bind pose when null)
+	template<typename ModelType>
+	ImpostorAtlas bake(ModelType& model, int framesPerSide = 8, int frameSize = 128, const std::vector<glm::mat4>* palette = nullptr)
+	{
+		return bake(model, model.sphereCenter, model.sphereRadius, framesPerSide, frameSize, palette);
+	}
+
+	template<typename ModelType>
+	ImpostorAtlas bake(ModelType& model, const glm::vec3& center, float radius, int framesPerSide, int frameSize, const std::vector<glm::mat4>* palette = nullptr)
+	{
+		ImpostorAtlas atlas;
+		atlas.framesPerSide = std::max(2, framesPerSide);
+		atlas.frameSize = frameSize;
+		atlas.center = center;
+		atlas.radius = std::max(radius, 1e-4f);
+		const int size = atlas.framesPerSide * frameSize;
+
+		GLint previousFramebuffer, previousViewport[4];
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glGetIntegerv(GL_VIEWPORT, previousViewport);
+		GLfloat previousClearColor[4];
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor);
+		const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+		// a few mip levels for distance, not so many that neighbouring frames bleed into each other
+		const int mipLevels = std::max(1, static_cast<int>(std::log2(static_cast<float>(frameSize))) - 4);
+		atlas.albedo = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, size, mipLevels);
+		atlas.normal = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, size, mipLevels);
+		atlas.depth = createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, size, 1);
+
+		unsigned int framebuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas.albedo, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, atlas.normal, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas.depth, 0);
+		const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, drawBuffers);
+
+		glViewport(0, 0, size, size);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+
+		m_BakeShader->use();
+		for (int i = 0; i < MAX_BAKE_BONES; i++)
+			m_BakeShader->setMat4("finalBonesMatrices[" + std::to_string(i) + "]", palette && i < static_cast<int>(palette->size()) ? (*palette)[i] : glm::mat4(1.0f));
+
+		// orthographic views from 2 radii out, depth range covering the whole sphere
+		const float r = atlas.radius;
+		m_BakeShader->setMat4("projection", glm::ortho(-r, r, -r, r, 0.0f, 4.0f * r));
+		for (int y = 0; y < atlas.framesPerSide; y++)
+		{
+			for (int x = 0; x < atlas.framesPerSide; x++)
+			{
+				const glm::vec3 direction = frameDirection(x, y, atlas.framesPerSide);
+				glm::vec3 right, up;
+				frameBasis(direction, right, up);
+				m_BakeShader->setMat4("view", glm::lookAt(center + direction * 2.0f * r, center, up));
+				glViewport(x * frameSize, y * frameSize, frameSize, frameSize);
+				model.Draw(*m_BakeShader);
+			}
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+		glDeleteFramebuffers(1, &framebuffer);
+		glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+		glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]);
+		if (!depthTest)
+			glDisable(GL_DEPTH_TEST);
+
+		for (unsigned int texture : { atlas.albedo, atlas.normal })
+		{
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return atlas;
+	}
+
+	// view direction (from the center towards the camera) of frame (x, y); matches octDecode in impostor.vs
+	static glm::vec3 frameDirection(int x, int y, int framesPerSide)
+	{
+		const glm::vec2 e = glm::vec2(x, y) / static_cast<float>(framesPerSide - 1) * 2.0f - 1.0f;
+		glm::vec3 d(e.x, 1.0f - std::abs(e.x) - std::abs(e.y), e.y);
+		if (d.y < 0.0f)
+		{
+			const glm::vec2 folded = (1.0f - glm::abs(glm::vec2(d.z, d.x))) * glm::vec2(d.x >= 0.0f ? 1.0f : -1.0f, d.z >= 0.0f ? 1.0f : -1.0f);
+			d.x = folded.x;
+			d.z = folded.y;
+		}
+		return glm::normalize(d);
+	}
+
+	// matches frameBasis in impostor.vs
+	static void frameBasis(const glm::vec3& direction, glm::vec3& right, glm::vec3& up)
+	{
+		const glm::vec3 worldUp = std::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		right = glm::normalize(glm::cross(worldUp, direction));
+		up = glm::cross(direction, right);
+	}
+
+private:
+	static const int MAX_BAKE_BONES = 100; // MAX_BONES of impostor_bake.vs
+
+	static unsigned int createTexture(GLint internalFormat, GLenum format, GLenum type, int size, int levels)
+	{
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size, size, 0, format, type, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return texture;
+	}
+
+	Shader* m_BakeShader;
+};
+
+struct ImpostorStats
+{
+	unsigned int instances = 0;
+	unsigned int draws = 0; // one per atlas with instances
+};
+
+// Draws every registered model's far instances as camera-facing quads with one glDrawArraysInstanced per atlas
+// (impostor.vs / impostor.fs). Per-instance model matrices go into one orphaned buffer, attribute locations 1-4.
+class ImpostorRenderer
+{
+public:
+	static const unsigned int INSTANCE_MATRIX_LOCATION = 1;
+
+	explicit ImpostorRenderer(Shader& impostorShader) : m_Shader(&impostorShader)
+	{
+		const float corners[] = { -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, 1.0f,  1.0f, 1.0f };
+		glGenVertexArrays(1, &m_VAO);
+		glGenBuffers(1, &m_QuadVBO);
+		glGenBuffers(1, &m_InstanceVBO);
+		glBindVertexArray(m_VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_QuadVBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		for (unsigned int column = 0; column < 4; column++)
+		{
+			glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + column);
+			glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + column, 1);
+		}
+		glBindVertexArray(0);
+	}
+
+	~ImpostorRenderer()
+	{
+		glDeleteBuffers(1, &m_InstanceVBO);
+		glDeleteBuffers(1, &m_QuadVBO);
+		glDeleteVertexArrays(1, &m_VAO);
+	}
+
+	ImpostorRenderer(const ImpostorRenderer&) = delete;
+	ImpostorRenderer& operator=(const ImpostorRenderer&) = delete;
+
+	// model is whatever the entities point at (Entity::pModel); the atlas stays owned by the caller
+	void registerModel(const void* model, const ImpostorAtlas& atlas)
+	{
+		m_Batches[model].atlas = atlas;
+	}
+
+	bool hasImpostor(const void* model) const
+	{
+		return m_Batches.find(model) != m_Batches.end();
+	}
+
+	void begin()
+	{
+		for (auto& batch : m_Batches)
+			batch.second.instances.clear();
+	}
+
+	void add(const void* model, const glm::mat4& modelMatrix)
+	{
+		m_Batches[model].instances.push_back(modelMatrix);
+	}
+
+	// lighting 0 matches the unlit anim_model.fs
+	void flush(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float lighting = 0.0f, const glm::vec3& lightDirection = glm::vec3(-0.3f, -1.0f, -0.2f))
+	{
+		m_Stats = ImpostorStats();
+		m_Matrices.clear();
+		for (auto& batch : m_Batches)
+			m_Matrices.insert(m_Matrices.end(), batch.second.instances.begin(), batch.second.instances.end());
+		if (m_Matrices.empty())
+			return;
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_InstanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, m_Matrices.size() * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, m_Matrices.size() * sizeof(glm::mat4), m_Matrices.data());
+
+		m_Shader->use();
+		m_Shader->setMat4("view", view);
+		m_Shader->setMat4("projection", projection);
+		m_Shader->setVec3("cameraPosition", cameraPosition);
+		m_Shader->setFloat("lighting", lighting);
+		m_Shader->setVec3("lightDirection", lightDirection);
+		m_Shader->setInt("impostorAlbedo", 0);
+		m_Shader->setInt("impostorNormal", 1);
+		m_Shader->setInt("impostorDepth", 2);
+		glBindVertexArray(m_VAO);
+
+		size_t firstMatrix = 0;
+		for (auto& batch : m_Batches)
+		{
+			const std::vector<glm::mat4>& instances = batch.second.instances;
+			if (instances.empty())
+				continue;
+			const ImpostorAtlas& atlas = batch.second.atlas;
+
+			// no base instance in GL 3.3, so the attribute pointers move to the batch's matrices instead
+			for (unsigned int column = 0; column < 4; column++)
+				glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+					(void*)(firstMatrix * sizeof(glm::mat4) + column * sizeof(glm::vec4)));
+
+			const unsigned int textures[] = { atlas.albedo, atlas.normal, atlas.depth };
+			for (unsigned int unit = 0; unit < 3; unit++)
+			{
+				glActiveTexture(GL_TEXTURE0 + unit);
+				glBindTexture(GL_TEXTURE_2D, textures[unit]);
+			}
+			m_Shader->setVec3("boundsCenter", atlas.center);
+			m_Shader->setFloat("boundsRadius", atlas.radius);
+			m_Shader->setFloat("framesPerSide", static_cast<float>(atlas.framesPerSide));
+
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(instances.size()));
+			m_Stats.draws++;
+			m_Stats.instances += static_cast<unsigned int>(instances.size());
+			firstMatrix += instances.size();
+		}
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	const ImpostorStats& getStats() const { return m_Stats; }
+
+private:
+	struct Batch
+	{
+		ImpostorAtlas atlas;
+		std::vector<glm::mat4> instances;
+	};
+
+	Shader* m_Shader;
+	unsigned int m_VAO = 0, m_QuadVBO = 0, m_InstanceVBO = 0;
+	std::unordered_map<const void*, Batch> m_Batches;
+	std::vector<glm::mat4> m_Matrices;
+	ImpostorStats m_Stats;
+};
+#endif
@@ -8,11 +8,16 @@
 
 #include <learnopengl/shader.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <string>
 #include <vector>
 using namespace std;
 
 #define MAX_BONE_INFLUENCE 4
+// full mesh plus simplified levels, see mesh_lod.h
+#define MAX_MESH_LODS 5
 
 struct Vertex {
     // position
@@ -44,6 +49,30 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
+    // GL_UNSIGNED_INT for meshes built from vertices/indices, external buffers may use narrower indices
+    GLenum indexType = GL_UNSIGNED_INT;
+    // object-space bounds, computed once when the mesh is created
+    glm::vec3 aabbMin;
+    glm::vec3 aabbMax;
+    glm::vec3 sphereCenter;
+    float sphereRadius;
+    // index ranges inside the EBO, lods[0] is the full mesh; coarser levels are appended by SetLODIndices
+    struct LOD {
+        unsigned int firstIndex;
+        unsigned int indexCount;
+        float error; // fraction of the bounding radius
+    };
+    vector<LOD> lods;
+    // clusters of the full-detail triangles, see meshlet.h
+    struct Meshlet {
+        glm::vec3 center;     // bounding sphere
+        float radius;
+        glm::vec3 coneAxis;   // average facing direction
+        float coneCutoff;     // sine of the cone's half angle widened to 90 degrees, >= 1 when it can't be backface culled
+        unsigned int firstIndex;
+        unsigned int indexCount;
+    };
+    vector<Meshlet> meshlets;
 
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
@@ -52,12 +81,41 @@ public:
         this->indices = indices;
         this->textures = textures;
 
+        computeBounds();
+        lods.push_back({ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
+    // mesh drawn from a VAO set up elsewhere, e.g. straight from a glTF buffer (see gltf_model.h). vertices and
+    // indices stay empty, so CPU-side processing (LODs, meshlets, batching) skips it; the caller owns the buffers.
+    Mesh(unsigned int vao, GLenum indexType, unsigned int firstIndex, unsigned int indexCount, glm::vec3 boundsMin, glm::vec3 boundsMax, vector<Texture> textures)
+    {
+        this->textures = textures;
+        this->VAO = vao;
+        this->indexType = indexType;
+        VBO = EBO = 0;
+
+        aabbMin = boundsMin;
+        aabbMax = boundsMax;
+        sphereCenter = (aabbMin + aabbMax) * 0.5f;
+        sphereRadius = glm::length(aabbMax - sphereCenter);
+        lods.push_back({ firstIndex, indexCount, 0.0f });
+    }
+
+    // byte offset of an index in the EBO, for the draw calls
+    void* IndexOffset(unsigned int firstIndex) const
+    {
+        const size_t size = indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        return (void*)(firstIndex * size);
+    }
+
+    glm::vec3 GetAABBCenter() const { return (aabbMin + aabbMax) * 0.5f; }
+    glm::vec3 GetAABBExtents() const { return (aabbMax - aabbMin) * 0.5f; }
+
+    // binds this mesh's textures to consecutive texture units and points the samplers at them
+    void BindTextures(Shader &shader) const
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -84,20 +142,101 @@ public:
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
-        
+    }
+
+    // render the mesh
+    void Draw(Shader &shader) 
+    {
+        BindTextures(shader);
+
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, lods[0].indexCount, indexType, IndexOffset(lods[0].firstIndex));
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // render one level of detail, clamped to the coarsest available
+    void Draw(Shader &shader, unsigned int lod)
+    {
+        const LOD &level = lods[std::min<size_t>(lod, lods.size() - 1)];
+        BindTextures(shader);
+
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, level.indexCount, indexType, IndexOffset(level.firstIndex));
+        glBindVertexArray(0);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // replaces the simplified levels (coarsest last) and re-uploads the EBO as the full index list followed by them.
+    // Meshes on an external VAO have no EBO or CPU indices of their own and keep their single level.
+    void SetLODIndices(const vector<vector<unsigned int>> &levels, const vector<float> &errors)
+    {
+        if (EBO == 0 || indices.empty())
+            return;
+        lods.resize(1);
+        vector<unsigned int> allIndices = indices;
+        for (size_t i = 0; i < levels.size() && lods.size() < MAX_MESH_LODS; i++)
+        {
+            lods.push_back({ static_cast<unsigned int>(allIndices.size()), static_cast<unsigned int>(levels[i].size()), i < errors.size() ? errors[i] : 0.0f });
+            allIndices.insert(allIndices.end(), levels[i].begin(), levels[i].end());
+        }
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(unsigned int), allIndices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+    }
+
+    // stores the clusters; reorderedIndices has the same triangles as indices, grouped by cluster.
+    // Ignored for meshes on an external VAO, like SetLODIndices.
+    void SetMeshlets(const vector<unsigned int> &reorderedIndices, const vector<Meshlet> &clusters)
+    {
+        if (EBO == 0 || indices.empty())
+            return;
+        indices = reorderedIndices;
+        meshlets = clusters;
+
+        // coarser levels after lods[0] keep their offsets
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(unsigned int), indices.data());
+        glBindVertexArray(0);
+    }
+
+    unsigned int GetVBO() const { return VBO; }
+    unsigned int GetEBO() const { return EBO; }
+
 private:
     // render data 
     unsigned int VBO, EBO;
 
+    // exact AABB of the vertices; the sphere is centered on it and reaches the farthest vertex
+    void computeBounds()
+    {
+        aabbMin = glm::vec3(std::numeric_limits<float>::max());
+        aabbMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const Vertex& vertex : vertices)
+        {
+            aabbMin = glm::min(aabbMin, vertex.Position);
+            aabbMax = glm::max(aabbMax, vertex.Position);
+        }
+        if (vertices.empty())
+            aabbMin = aabbMax = glm::vec3(0.0f);
+
+        sphereCenter = (aabbMin + aabbMax) * 0.5f;
+        float radius2 = 0.0f;
+        for (const Vertex& vertex : vertices)
+        {
+            const glm::vec3 d = vertex.Position - sphereCenter;
+            radius2 = std::max(radius2, glm::dot(d, d));
+        }
+        sphereRadius = std::sqrt(radius2);
+    }
+
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
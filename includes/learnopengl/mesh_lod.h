@@ -0,0 +1,543 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+struct MeshLODSettings
+{
+	// triangle count of each generated level relative to the full mesh, coarsest last (at most MAX_MESH_LODS - 1)
+	std::vector<float> triangleRatios = { 0.5f, 0.25f, 0.1f };
+	// simplification stops once the geometric error would exceed this fraction of the mesh's bounding radius
+	float maxError = 0.05f;
+	// a level that removes less than this fraction of the previous level's triangles is not worth keeping
+	float minReduction = 0.1f;
+};
+
+// runtime choice of a level from the projected size (fraction of the viewport height covered by the bounding sphere)
+struct LODSelection
+{
+	// level i + 1 is used below screenSizes[i]
+	std::vector<float> screenSizes = { 0.25f, 0.12f, 0.05f };
+	// a switch only happens once the size is this much past the threshold, so entities don't flicker at the boundary
+	float hysteresis = 0.1f;
+
+	unsigned int select(float screenSize, unsigned int current, unsigned int lodCount) const
+	{
+		if (lodCount <= 1)
+			return 0;
+		unsigned int target = 0;
+		while (target < screenSizes.size() && screenSize < screenSizes[target])
+			target++;
+		target = std::min(target, lodCount - 1);
+		current = std::min(current, lodCount - 1);
+
+		// coarser: size has to be below every crossed threshold by the margin
+		while (current < target && screenSize < screenSizes[current] * (1.0f - hysteresis))
+			current++;
+		// finer: size has to be above every crossed threshold by the margin
+		while (current > target && screenSize > screenSizes[current - 1] * (1.0f + hysteresis))
+			current--;
+		return current;
+	}
+
+	// bounding sphere at distance from the camera; projectionScaleY is projection[1][1]
+	static float screenSize(float radius, float distance, float projectionScaleY)
+	{
+		if (distance <= radius)
+			return 1.0f;
+		return radius * projectionScaleY / distance;
+	}
+};
+
+struct LODReport
+{
+	struct Level
+	{
+		unsigned int triangles;
+		float error; // fraction of the mesh's bounding radius
+	};
+
+	struct MeshEntry
+	{
+		unsigned int mesh;
+		std::vector<Level> levels; // levels[0] is the full mesh
+	};
+
+	std::vector<MeshEntry> meshes;
+	double milliseconds = 0.0;
+
+	void print(std::ostream& out) const
+	{
+		size_t maxLevels = 0;
+		for (const MeshEntry& entry : meshes)
+			maxLevels = std::max(maxLevels, entry.levels.size());
+
+		out << "LOD report: " << meshes.size() << " meshes, " << std::fixed << std::setprecision(1) << milliseconds << " ms\n";
+		for (const MeshEntry& entry : meshes)
+		{
+			out << "  mesh " << entry.mesh << ":";
+			for (size_t l = 0; l < entry.levels.size(); l++)
+				out << "  LOD" << l << " " << entry.levels[l].triangles << " tris (err " << std::setprecision(4) << entry.levels[l].error << ")";
+			out << "\n";
+		}
+		for (size_t l = 0; l < maxLevels; l++)
+		{
+			unsigned int triangles = 0;
+			for (const MeshEntry& entry : meshes)
+				triangles += entry.levels[std::min(l, entry.levels.size() - 1)].triangles;
+			out << "  total LOD" << l << ": " << triangles << " tris\n";
+		}
+		out << std::defaultfloat;
+	}
+};
+
+// Quadric error metric simplification by half-edge collapses: a vertex is always merged into one of its
+// neighbors and never moved, so the surviving vertices are original ones and their bone ids and weights
+// stay valid. Vertices are welded by position for the topology; UV-seam duplicates only collapse onto other
+// seam vertices, each duplicate going to the neighbor's duplicate with the closest UV.
+class QuadricSimplifier
+{
+public:
+	QuadricSimplifier(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+		: m_Vertices(vertices)
+	{
+		weldPositions();
+
+		const size_t numTriangles = indices.size() / 3;
+		m_Triangles.resize(numTriangles);
+		m_TriangleAlive.assign(numTriangles, 1);
+		m_VertexTriangles.resize(m_Positions.size());
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			for (int c = 0; c < 3; c++)
+				m_Triangles[t].corner[c] = indices[t * 3 + c];
+			const uint32_t a = canonical(m_Triangles[t].corner[0]);
+			const uint32_t b = canonical(m_Triangles[t].corner[1]);
+			const uint32_t c = canonical(m_Triangles[t].corner[2]);
+			if (a == b || b == c || a == c)
+			{
+				m_TriangleAlive[t] = 0;
+				continue;
+			}
+			m_VertexTriangles[a].push_back(static_cast<uint32_t>(t));
+			m_VertexTriangles[b].push_back(static_cast<uint32_t>(t));
+			m_VertexTriangles[c].push_back(static_cast<uint32_t>(t));
+			m_TriangleCount++;
+		}
+
+		glm::vec3 minPos(std::numeric_limits<float>::max()), maxPos(std::numeric_limits<float>::lowest());
+		for (const glm::vec3& p : m_Positions)
+		{
+			minPos = glm::min(minPos, p);
+			maxPos = glm::max(maxPos, p);
+		}
+		m_Radius = m_Positions.empty() ? 1.0f : std::max(1e-6f, glm::length(maxPos - minPos) * 0.5f);
+
+		computeQuadrics();
+		for (size_t t = 0; t < m_Triangles.size(); t++)
+		{
+			if (!m_TriangleAlive[t])
+				continue;
+			for (int c = 0; c < 3; c++)
+			{
+				const uint32_t a = canonical(m_Triangles[t].corner[c]);
+				const uint32_t b = canonical(m_Triangles[t].corner[(c + 1) % 3]);
+				pushCollapse(a, b);
+				pushCollapse(b, a);
+			}
+		}
+	}
+
+	// collapses until at most targetTriangles remain or the next collapse would exceed maxError
+	// (fraction of the bounding radius); returns the error reached so far
+	float simplify(size_t targetTriangles, float maxError)
+	{
+		const float maxCost = (maxError * m_Radius) * (maxError * m_Radius);
+		while (m_TriangleCount > targetTriangles && !m_Heap.empty())
+		{
+			const Collapse collapse = m_Heap.top();
+			if (collapse.cost > maxCost)
+				break;
+			m_Heap.pop();
+
+			if (m_Removed[collapse.from] || m_Removed[collapse.to] ||
+				collapse.fromVersion != m_Version[collapse.from] || collapse.toVersion != m_Version[collapse.to])
+				continue;
+			if (!canCollapse(collapse.from, collapse.to))
+				continue;
+
+			applyCollapse(collapse.from, collapse.to);
+			m_MaxCost = std::max(m_MaxCost, collapse.cost);
+		}
+		return error();
+	}
+
+	size_t triangleCount() const { return m_TriangleCount; }
+	float error() const { return std::sqrt(m_MaxCost) / m_Radius; }
+
+	// current index buffer, referencing the original vertices
+	void getIndices(std::vector<unsigned int>& out)
+	{
+		out.clear();
+		out.reserve(m_TriangleCount * 3);
+		for (size_t t = 0; t < m_Triangles.size(); t++)
+		{
+			if (!m_TriangleAlive[t])
+				continue;
+			for (int c = 0; c < 3; c++)
+				out.push_back(resolve(m_Triangles[t].corner[c]));
+		}
+	}
+
+private:
+	// symmetric 4x4 matrix of the plane equations, plus the total weight to normalize errors
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0, weight = 0;
+
+		void addPlane(const glm::dvec3& n, double d, double w)
+		{
+			a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+			b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+			c2 += w * n.z * n.z; cd += w * n.z * d;
+			d2 += w * d * d;
+			weight += w;
+		}
+
+		void add(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd; d2 += q.d2; weight += q.weight;
+		}
+
+		// weighted sum of squared distances to the planes
+		double evaluate(const glm::vec3& p) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+				b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+				c2 * z * z + 2 * cd * z + d2;
+		}
+	};
+
+	struct Triangle
+	{
+		uint32_t corner[3]; // original vertex indices, see resolve()
+	};
+
+	struct Collapse
+	{
+		float cost;
+		uint32_t from, to;
+		uint32_t fromVersion, toVersion;
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	// boundary edges get a perpendicular constraint plane this many times stronger than a face
+	static constexpr double BOUNDARY_WEIGHT = 10.0;
+
+	void weldPositions()
+	{
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				uint32_t bits[3];
+				std::memcpy(bits, &p.x, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> unique;
+		m_Canonical.resize(m_Vertices.size());
+		m_Remap.resize(m_Vertices.size());
+		for (size_t v = 0; v < m_Vertices.size(); v++)
+		{
+			auto inserted = unique.emplace(m_Vertices[v].Position, static_cast<uint32_t>(m_Positions.size()));
+			if (inserted.second)
+			{
+				m_Positions.push_back(m_Vertices[v].Position);
+				m_Wedges.emplace_back();
+			}
+			m_Canonical[v] = inserted.first->second;
+			m_Wedges[m_Canonical[v]].push_back(static_cast<uint32_t>(v));
+			m_Remap[v] = static_cast<uint32_t>(v);
+		}
+		m_Removed.assign(m_Positions.size(), 0);
+		m_Version.assign(m_Positions.size(), 0);
+	}
+
+	// original vertex after all collapses so far
+	uint32_t resolve(uint32_t vertex)
+	{
+		uint32_t root = vertex;
+		while (m_Remap[root] != root)
+			root = m_Remap[root];
+		while (m_Remap[vertex] != root)
+		{
+			const uint32_t next = m_Remap[vertex];
+			m_Remap[vertex] = root;
+			vertex = next;
+		}
+		return root;
+	}
+
+	uint32_t canonical(uint32_t vertex) { return m_Canonical[resolve(vertex)]; }
+
+	void triangleCanonicals(uint32_t t, uint32_t out[3])
+	{
+		for (int c = 0; c < 3; c++)
+			out[c] = canonical(m_Triangles[t].corner[c]);
+	}
+
+	void computeQuadrics()
+	{
+		m_Quadrics.assign(m_Positions.size(), Quadric());
+		std::unordered_map<uint64_t, int> edgeUse;
+		auto edgeKey = [](uint32_t a, uint32_t b) { return a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a); };
+
+		for (size_t t = 0; t < m_Triangles.size(); t++)
+		{
+			if (!m_TriangleAlive[t])
+				continue;
+			uint32_t v[3];
+			triangleCanonicals(static_cast<uint32_t>(t), v);
+			const glm::dvec3 p0(m_Positions[v[0]]), p1(m_Positions[v[1]]), p2(m_Positions[v[2]]);
+			glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const double length = glm::length(normal);
+			if (length <= 0.0)
+				continue;
+			normal /= length;
+			const double area = length * 0.5;
+			for (int c = 0; c < 3; c++)
+			{
+				m_Quadrics[v[c]].addPlane(normal, -glm::dot(normal, p0), area);
+				edgeUse[edgeKey(v[c], v[(c + 1) % 3])]++;
+			}
+		}
+
+		// open borders would otherwise shrink freely, since moving along their face plane costs nothing
+		for (size_t t = 0; t < m_Triangles.size(); t++)
+		{
+			if (!m_TriangleAlive[t])
+				continue;
+			uint32_t v[3];
+			triangleCanonicals(static_cast<uint32_t>(t), v);
+			const glm::dvec3 p0(m_Positions[v[0]]), p1(m_Positions[v[1]]), p2(m_Positions[v[2]]);
+			const glm::dvec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+			if (glm::length(faceNormal) <= 0.0)
+				continue;
+			for (int c = 0; c < 3; c++)
+			{
+				const uint32_t a = v[c], b = v[(c + 1) % 3];
+				if (edgeUse[edgeKey(a, b)] != 1)
+					continue;
+				const glm::dvec3 pa(m_Positions[a]), pb(m_Positions[b]);
+				const glm::dvec3 edge = pb - pa;
+				glm::dvec3 normal = glm::cross(edge, faceNormal);
+				const double length = glm::length(normal);
+				if (length <= 0.0)
+					continue;
+				normal /= length;
+				const double weight = glm::dot(edge, edge) * BOUNDARY_WEIGHT;
+				m_Quadrics[a].addPlane(normal, -glm::dot(normal, pa), weight);
+				m_Quadrics[b].addPlane(normal, -glm::dot(normal, pa), weight);
+			}
+		}
+	}
+
+	void pushCollapse(uint32_t from, uint32_t to)
+	{
+		// a seam vertex moved onto a non-seam vertex would lose one side of its UVs
+		if (m_Wedges[from].size() > 1 && m_Wedges[to].size() == 1)
+			return;
+
+		Quadric q = m_Quadrics[from];
+		q.add(m_Quadrics[to]);
+		const double cost = std::max(0.0, q.evaluate(m_Positions[to])) / std::max(q.weight, 1e-12);
+		m_Heap.push({ static_cast<float>(cost), from, to, m_Version[from], m_Version[to] });
+	}
+
+	// rejects collapses that would flip a remaining triangle around from
+	bool canCollapse(uint32_t from, uint32_t to)
+	{
+		for (uint32_t t : m_VertexTriangles[from])
+		{
+			if (!m_TriangleAlive[t])
+				continue;
+			uint32_t v[3];
+			triangleCanonicals(t, v);
+			if (v[0] == to || v[1] == to || v[2] == to)
+				continue;
+
+			glm::vec3 p[3], moved[3];
+			for (int c = 0; c < 3; c++)
+			{
+				p[c] = m_Positions[v[c]];
+				moved[c] = v[c] == from ? m_Positions[to] : p[c];
+			}
+			const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			const glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+			if (glm::dot(before, after) <= 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	void applyCollapse(uint32_t from, uint32_t to)
+	{
+		for (uint32_t t : m_VertexTriangles[from])
+		{
+			if (!m_TriangleAlive[t])
+				continue;
+			uint32_t v[3];
+			triangleCanonicals(t, v);
+			if (v[0] == to || v[1] == to || v[2] == to)
+			{
+				m_TriangleAlive[t] = 0;
+				m_TriangleCount--;
+			}
+		}
+
+		// every duplicate of from goes to the duplicate of to whose UV is closest
+		for (uint32_t wedge : m_Wedges[from])
+		{
+			uint32_t best = m_Wedges[to][0];
+			float bestDistance = std::numeric_limits<float>::max();
+			for (uint32_t candidate : m_Wedges[to])
+			{
+				const glm::vec2 d = m_Vertices[candidate].TexCoords - m_Vertices[wedge].TexCoords;
+				const float distance = glm::dot(d, d);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = candidate;
+				}
+			}
+			m_Remap[wedge] = best;
+		}
+
+		m_Removed[from] = 1;
+		m_Quadrics[to].add(m_Quadrics[from]);
+		m_Version[to]++;
+
+		std::vector<uint32_t>& toTriangles = m_VertexTriangles[to];
+		for (uint32_t t : m_VertexTriangles[from])
+		{
+			if (m_TriangleAlive[t])
+				toTriangles.push_back(t);
+		}
+		m_VertexTriangles[from].clear();
+		m_VertexTriangles[from].shrink_to_fit();
+		toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(), [&](uint32_t t) { return !m_TriangleAlive[t]; }), toTriangles.end());
+
+		// the quadric of to changed, so every edge touching it gets a new cost
+		for (uint32_t t : toTriangles)
+		{
+			uint32_t v[3];
+			triangleCanonicals(t, v);
+			for (int c = 0; c < 3; c++)
+			{
+				if (v[c] == to)
+					continue;
+				pushCollapse(to, v[c]);
+				pushCollapse(v[c], to);
+			}
+		}
+	}
+
+	const std::vector<Vertex>& m_Vertices;
+	std::vector<glm::vec3> m_Positions;           // per welded vertex
+	std::vector<std::vector<uint32_t>> m_Wedges;  // original vertices of each welded vertex
+	std::vector<uint32_t> m_Canonical;            // original vertex -> welded vertex
+	std::vector<uint32_t> m_Remap;                // original vertex -> vertex it collapsed into
+	std::vector<Quadric> m_Quadrics;
+	std::vector<std::vector<uint32_t>> m_VertexTriangles;
+	std::vector<uint8_t> m_Removed;
+	std::vector<uint32_t> m_Version;
+
+	std::vector<Triangle> m_Triangles;
+	std::vector<uint8_t> m_TriangleAlive;
+	size_t m_TriangleCount = 0;
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_Heap;
+	float m_Radius = 1.0f;
+	float m_MaxCost = 0.0f;
+};
+
+// simplified index buffers for one mesh, coarsest last; errors are fractions of the mesh's bounding radius
+inline void GenerateMeshLODs(const Mesh& mesh, const MeshLODSettings& settings, std::vector<std::vector<unsigned int>>& outLevels, std::vector<float>& outErrors)
+{
+	outLevels.clear();
+	outErrors.clear();
+	if (mesh.indices.size() < 3)
+		return;
+
+	QuadricSimplifier simplifier(mesh.vertices, mesh.indices);
+	size_t previousTriangles = mesh.indices.size() / 3;
+	const size_t maxLevels = std::min<size_t>(settings.triangleRatios.size(), MAX_MESH_LODS - 1);
+	for (size_t level = 0; level < maxLevels; level++)
+	{
+		const size_t target = static_cast<size_t>(mesh.indices.size() / 3 * settings.triangleRatios[level]);
+		const float error = simplifier.simplify(target, settings.maxError);
+		const size_t triangles = simplifier.triangleCount();
+		if (triangles == 0 || triangles > previousTriangles * (1.0f - settings.minReduction))
+			break;
+
+		outLevels.emplace_back();
+		simplifier.getIndices(outLevels.back());
+		outErrors.push_back(error);
+		previousTriangles = triangles;
+	}
+}
+
+// import-time LOD generation for every mesh of a model: simplification runs on the pool, the index buffers
+// are uploaded on the calling thread (which owns the GL context)
+template<typename ModelType>
+void GenerateModelLODs(ModelType& model, const MeshLODSettings& settings = MeshLODSettings(), LODReport* report = nullptr, ThreadPool& pool = ThreadPool::global())
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::vector<std::vector<unsigned int>>> levels(model.meshes.size());
+	std::vector<std::vector<float>> errors(model.meshes.size());
+	pool.parallelFor(model.meshes.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t m = begin; m < end; m++)
+			GenerateMeshLODs(model.meshes[m], settings, levels[m], errors[m]);
+	});
+
+	for (size_t m = 0; m < model.meshes.size(); m++)
+		model.meshes[m].SetLODIndices(levels[m], errors[m]);
+
+	if (report)
+	{
+		report->meshes.clear();
+		for (size_t m = 0; m < model.meshes.size(); m++)
+		{
+			LODReport::MeshEntry entry;
+			entry.mesh = static_cast<unsigned int>(m);
+			for (const Mesh::LOD& lod : model.meshes[m].lods)
+				entry.levels.push_back({ lod.indexCount / 3, lod.error });
+			report->meshes.push_back(entry);
+		}
+		const auto stop = std::chrono::high_resolution_clock::now();
+		report->milliseconds = std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+}
+#endif
@@ -0,0 +1,301 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum_culler.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Splits a triangle list into clusters of at most maxVertices unique vertices and maxTriangles triangles.
+// Clusters grow over shared vertices, preferring triangles that add few new vertices and face the same way,
+// so they stay compact and their normal cones narrow. outIndices holds the same triangles grouped by cluster.
+inline void BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	std::vector<unsigned int>& outIndices, std::vector<Mesh::Meshlet>& outMeshlets,
+	unsigned int maxVertices = MESHLET_MAX_VERTICES, unsigned int maxTriangles = MESHLET_MAX_TRIANGLES)
+{
+	outIndices.clear();
+	outMeshlets.clear();
+	const size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0)
+		return;
+	outIndices.reserve(numTriangles * 3);
+
+	std::vector<glm::vec3> normals(numTriangles);
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		const glm::vec3& p0 = vertices[indices[t * 3]].Position;
+		const glm::vec3& p1 = vertices[indices[t * 3 + 1]].Position;
+		const glm::vec3& p2 = vertices[indices[t * 3 + 2]].Position;
+		const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		const float length = glm::length(n);
+		normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+	}
+
+	// vertex -> triangles, compressed rows
+	std::vector<uint32_t> adjacencyStart(vertices.size() + 1, 0);
+	for (unsigned int index : indices)
+		adjacencyStart[index + 1]++;
+	for (size_t v = 0; v < vertices.size(); v++)
+		adjacencyStart[v + 1] += adjacencyStart[v];
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<uint8_t> emitted(numTriangles, 0);
+	std::vector<uint32_t> vertexMeshlet(vertices.size(), 0xFFFFFFFFu); // last meshlet that used the vertex
+	std::vector<uint32_t> meshletVertices;
+	size_t seed = 0;
+
+	while (true)
+	{
+		while (seed < numTriangles && emitted[seed])
+			seed++;
+		if (seed == numTriangles)
+			break;
+
+		const uint32_t meshletId = static_cast<uint32_t>(outMeshlets.size());
+		const unsigned int firstIndex = static_cast<unsigned int>(outIndices.size());
+		meshletVertices.clear();
+		glm::vec3 normalSum(0.0f);
+		unsigned int triangleCount = 0;
+
+		auto newVertices = [&](size_t t)
+		{
+			unsigned int count = 0;
+			for (int c = 0; c < 3; c++)
+				count += vertexMeshlet[indices[t * 3 + c]] != meshletId;
+			return count;
+		};
+		auto addTriangle = [&](size_t t)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				const unsigned int v = indices[t * 3 + c];
+				if (vertexMeshlet[v] != meshletId)
+				{
+					vertexMeshlet[v] = meshletId;
+					meshletVertices.push_back(v);
+				}
+				outIndices.push_back(v);
+			}
+			emitted[t] = 1;
+			normalSum += normals[t];
+			triangleCount++;
+		};
+
+		addTriangle(seed);
+		while (triangleCount < maxTriangles)
+		{
+			const glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+			size_t best = numTriangles;
+			float bestScore = std::numeric_limits<float>::max();
+			for (unsigned int v : meshletVertices)
+			{
+				for (uint32_t a = adjacencyStart[v]; a < adjacencyStart[v + 1]; a++)
+				{
+					const uint32_t t = adjacency[a];
+					if (emitted[t])
+						continue;
+					const unsigned int added = newVertices(t);
+					if (meshletVertices.size() + added > maxVertices)
+						continue;
+					// new vertices dominate, facing breaks ties
+					const float score = added + (1.0f - glm::dot(normals[t], axis)) * 0.5f;
+					if (score < bestScore)
+					{
+						bestScore = score;
+						best = t;
+					}
+				}
+			}
+			if (best == numTriangles)
+				break;
+			addTriangle(best);
+		}
+
+		Mesh::Meshlet meshlet;
+		meshlet.firstIndex = firstIndex;
+		meshlet.indexCount = triangleCount * 3;
+
+		glm::vec3 minPos(std::numeric_limits<float>::max()), maxPos(std::numeric_limits<float>::lowest());
+		for (unsigned int v : meshletVertices)
+		{
+			minPos = glm::min(minPos, vertices[v].Position);
+			maxPos = glm::max(maxPos, vertices[v].Position);
+		}
+		meshlet.center = (minPos + maxPos) * 0.5f;
+		float radius2 = 0.0f;
+		for (unsigned int v : meshletVertices)
+		{
+			const glm::vec3 d = vertices[v].Position - meshlet.center;
+			radius2 = std::max(radius2, glm::dot(d, d));
+		}
+		meshlet.radius = std::sqrt(radius2);
+
+		// the cone spans every triangle normal; past 90 degrees nothing can be concluded
+		const float sumLength = glm::length(normalSum);
+		meshlet.coneAxis = sumLength > 0.0f ? normalSum / sumLength : glm::vec3(0.0f, 0.0f, 1.0f);
+		float minDot = 1.0f;
+		for (unsigned int i = firstIndex; i < firstIndex + meshlet.indexCount; i += 3)
+		{
+			const glm::vec3& p0 = vertices[outIndices[i]].Position;
+			const glm::vec3& p1 = vertices[outIndices[i + 1]].Position;
+			const glm::vec3& p2 = vertices[outIndices[i + 2]].Position;
+			const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			const float length = glm::length(n);
+			if (length > 0.0f)
+				minDot = std::min(minDot, glm::dot(n / length, meshlet.coneAxis));
+		}
+		meshlet.coneCutoff = (sumLength <= 0.0f || minDot <= 0.0f) ? 2.0f : std::sqrt(1.0f - minDot * minDot);
+
+		outMeshlets.push_back(meshlet);
+	}
+}
+
+// import-time clustering of every mesh of a model, on the pool; the reordered index buffers are uploaded
+// on the calling thread
+template<typename ModelType>
+void BuildModelMeshlets(ModelType& model, ThreadPool& pool = ThreadPool::global())
+{
+	std::vector<std::vector<unsigned int>> indices(model.meshes.size());
+	std::vector<std::vector<Mesh::Meshlet>> meshlets(model.meshes.size());
+	pool.parallelFor(model.meshes.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t m = begin; m < end; m++)
+			BuildMeshlets(model.meshes[m].vertices, model.meshes[m].indices, indices[m], meshlets[m]);
+	});
+
+	for (size_t m = 0; m < model.meshes.size(); m++)
+		model.meshes[m].SetMeshlets(indices[m], meshlets[m]);
+}
+
+struct MeshletStats
+{
+	unsigned int clusters = 0;
+	unsigned int frustumCulled = 0;
+	unsigned int backfaceCulled = 0;
+	unsigned int trianglesTotal = 0;
+	unsigned int trianglesSubmitted = 0;
+	unsigned int ranges = 0; // index ranges handed to glMultiDrawElements after merging neighbours
+};
+
+// CPU cluster culling: each meshlet's bounding sphere is tested against the frustum and its normal cone
+// against the camera position, and the surviving index ranges are drawn with one glMultiDrawElements per
+// mesh. Meshes without meshlets are drawn whole.
+class MeshletCuller
+{
+public:
+	void beginFrame(const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+	{
+		m_Frustum = FrustumPlanes::fromViewProjection(viewProjection);
+		m_CameraPosition = cameraPosition;
+		m_Stats = MeshletStats();
+	}
+
+	// collects the visible clusters of mesh into the culler's range arrays, returns how many ranges
+	size_t cull(const Mesh& mesh, const glm::mat4& modelMatrix, const glm::vec3& localCamera, float maxScale)
+	{
+		m_Counts.clear();
+		m_Offsets.clear();
+
+		for (const Mesh::Meshlet& meshlet : mesh.meshlets)
+		{
+			m_Stats.clusters++;
+			m_Stats.trianglesTotal += meshlet.indexCount / 3;
+
+			// backfacing: the whole sphere lies behind the cone. Done in model space, which keeps the
+			// angles intact for rotations and uniform scale
+			const glm::vec3 toCluster = meshlet.center - localCamera;
+			if (glm::dot(toCluster, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCluster) + meshlet.radius)
+			{
+				m_Stats.backfaceCulled++;
+				continue;
+			}
+
+			const glm::vec3 center{ modelMatrix * glm::vec4(meshlet.center, 1.0f) };
+			if (!isSphereVisible(center, meshlet.radius * maxScale))
+			{
+				m_Stats.frustumCulled++;
+				continue;
+			}
+
+			// consecutive clusters are consecutive in the index buffer
+			if (!m_Counts.empty() && m_LastEnd == meshlet.firstIndex)
+				m_Counts.back() += meshlet.indexCount;
+			else
+			{
+				m_Counts.push_back(static_cast<GLsizei>(meshlet.indexCount));
+				m_Offsets.push_back((const void*)(meshlet.firstIndex * sizeof(unsigned int)));
+			}
+			m_LastEnd = meshlet.firstIndex + meshlet.indexCount;
+			m_Stats.trianglesSubmitted += meshlet.indexCount / 3;
+		}
+		m_Stats.ranges += static_cast<unsigned int>(m_Counts.size());
+		return m_Counts.size();
+	}
+
+	void drawMesh(Mesh& mesh, Shader& shader, const glm::mat4& modelMatrix, const glm::vec3& localCamera, float maxScale)
+	{
+		if (mesh.meshlets.empty())
+		{
+			mesh.Draw(shader);
+			m_Stats.trianglesTotal += static_cast<unsigned int>(mesh.indices.size() / 3);
+			m_Stats.trianglesSubmitted += static_cast<unsigned int>(mesh.indices.size() / 3);
+			return;
+		}
+		if (cull(mesh, modelMatrix, localCamera, maxScale) == 0)
+			return;
+
+		mesh.BindTextures(shader);
+		glBindVertexArray(mesh.VAO);
+		glMultiDrawElements(GL_TRIANGLES, m_Counts.data(), GL_UNSIGNED_INT, m_Offsets.data(), static_cast<GLsizei>(m_Counts.size()));
+		glBindVertexArray(0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	// "model" has to be set on shader already, as for Model::Draw
+	template<typename ModelType>
+	void drawModel(ModelType& model, Shader& shader, const glm::mat4& modelMatrix)
+	{
+		const glm::vec3 localCamera{ glm::inverse(modelMatrix) * glm::vec4(m_CameraPosition, 1.0f) };
+		const float maxScale = std::max(std::max(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1]))), glm::length(glm::vec3(modelMatrix[2])));
+		for (Mesh& mesh : model.meshes)
+			drawMesh(mesh, shader, modelMatrix, localCamera, maxScale);
+	}
+
+	const MeshletStats& getStats() const { return m_Stats; }
+
+private:
+	bool isSphereVisible(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : m_Frustum.planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	FrustumPlanes m_Frustum;
+	glm::vec3 m_CameraPosition = glm::vec3(0.0f);
+	std::vector<GLsizei> m_Counts;
+	std::vector<const void*> m_Offsets;
+	unsigned int m_LastEnd = 0;
+	MeshletStats m_Stats;
+};
+#endif
@@ -12,6 +12,8 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_cook.h>
+#include <learnopengl/texture_streamer.h>
 
 #include <string>
 #include <fstream>
@@ -31,9 +33,16 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // loads the textures with only their mip tail resident when set, see texture_streamer.h
+    TextureStreamer* textureStreamer;
+    // object-space bounds of all meshes, derived from the per-mesh bounds after import
+    glm::vec3 aabbMin = glm::vec3(0.0f);
+    glm::vec3 aabbMax = glm::vec3(0.0f);
+    glm::vec3 sphereCenter = glm::vec3(0.0f);
+    float sphereRadius = 0.0f;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, TextureStreamer* streamer = nullptr) : gammaCorrection(gamma), textureStreamer(streamer)
     {
         loadModel(path);
     }
@@ -44,8 +53,42 @@ public:
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // draws every mesh at the given level of detail (see mesh_lod.h)
+    void Draw(Shader &shader, unsigned int lod)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader, lod);
+    }
+
+    // most levels any mesh has
+    unsigned int GetLODCount() const
+    {
+        size_t count = 1;
+        for(const Mesh &mesh : meshes)
+            count = std::max(count, mesh.lods.size());
+        return static_cast<unsigned int>(count);
+    }
     
 private:
+    // model bounds from the meshes' own bounds, no vertex loop
+    void computeBounds()
+    {
+        if (meshes.empty())
+            return;
+        aabbMin = glm::vec3(std::numeric_limits<float>::max());
+        aabbMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const Mesh& mesh : meshes)
+        {
+            aabbMin = glm::min(aabbMin, mesh.aabbMin);
+            aabbMax = glm::max(aabbMax, mesh.aabbMax);
+        }
+        sphereCenter = (aabbMin + aabbMax) * 0.5f;
+        sphereRadius = 0.0f;
+        for (const Mesh& mesh : meshes)
+            sphereRadius = std::max(sphereRadius, glm::length(mesh.sphereCenter - sphereCenter) + mesh.sphereRadius);
+    }
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
@@ -63,6 +106,8 @@ private:
 
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+
+        computeBounds();
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -191,7 +236,13 @@ private:
             if(!skip)
             {   // if texture hasn't been loaded already, load it
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                // streamed or whole block-compressed mip chain from the cooked cache, plain decode when the image or format isn't usable
+                const TextureCookKind kind = typeName == "texture_normal" ? TEXTURE_COOK_NORMAL : TEXTURE_COOK_COLOR;
+                texture.id = textureStreamer ? textureStreamer->load(str.C_Str(), this->directory, kind) : 0;
+                if (!texture.id)
+                    texture.id = CookedTextureFromFile(str.C_Str(), this->directory, kind);
+                if (!texture.id)
+                    texture.id = TextureFromFile(str.C_Str(), this->directory);
                 texture.type = typeName;
                 texture.path = str.C_Str();
                 textures.push_back(texture);
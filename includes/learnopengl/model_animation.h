@@ -10,8 +10,11 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <learnopengl/frustum_culler.h>
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_cook.h>
+#include <learnopengl/texture_streamer.h>
 
 #include <string>
 #include <fstream>
@@ -32,13 +35,64 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // loads the textures with only their mip tail resident when set, see texture_streamer.h
+    TextureStreamer* textureStreamer;
+    // object-space bounds of all meshes, derived from the per-mesh bounds after import
+    glm::vec3 aabbMin = glm::vec3(0.0f);
+    glm::vec3 aabbMax = glm::vec3(0.0f);
+    glm::vec3 sphereCenter = glm::vec3(0.0f);
+    float sphereRadius = 0.0f;
 	
 	
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, TextureStreamer* streamer = nullptr) : gammaCorrection(gamma), textureStreamer(streamer)
     {
-        loadModel(path);
+        if (Import(path))
+            Upload();
+    }
+
+    // empty model for loading in two steps, Import() then Upload() (see asset_manager.h)
+    Model() : gammaCorrection(false), textureStreamer(nullptr)
+    {
+    }
+
+    // CPU half of loading, no GL calls so it can run on a worker: parses the file, builds the vertices and bone
+    // map, and reads (or cooks) the texture caches. Returns false when Assimp can't load the file.
+    bool Import(string const &path)
+    {
+        return loadModel(path);
+    }
+
+    // GL half of loading, on the thread that owns the context: creates the textures and the mesh buffers from
+    // what Import() prepared and releases the CPU copies of the texture data
+    void Upload()
+    {
+        for (PendingTexture &pending : m_PendingTextures)
+        {
+            Texture texture;
+            // streamed or whole block-compressed mip chain from the cooked cache, plain decode when the image or format isn't usable
+            texture.id = textureStreamer ? textureStreamer->load(pending.path.c_str(), this->directory, pending.kind) : 0;
+            if (!texture.id)
+                texture.id = UploadCookedTexture(pending.cooked);
+            if (!texture.id)
+                texture.id = TextureFromFile(pending.path.c_str(), this->directory);
+            texture.type = pending.type;
+            texture.path = pending.path;
+            textures_loaded.push_back(texture);
+        }
+
+        for (PendingMesh &pending : m_PendingMeshes)
+        {
+            vector<Texture> textures;
+            for (size_t index : pending.textures)
+                textures.push_back(textures_loaded[index]);
+            meshes.push_back(Mesh(std::move(pending.vertices), std::move(pending.indices), textures));
+        }
+        m_PendingTextures.clear();
+        m_PendingMeshes.clear();
+
+        computeBounds();
     }
 
     // draws the model, and thus all its meshes
@@ -47,9 +101,71 @@ public:
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // draws every mesh at the given level of detail (see mesh_lod.h)
+    void Draw(Shader &shader, unsigned int lod)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader, lod);
+    }
+
+    // most levels any mesh has
+    unsigned int GetLODCount() const
+    {
+        size_t count = 1;
+        for(const Mesh &mesh : meshes)
+            count = std::max(count, mesh.lods.size());
+        return static_cast<unsigned int>(count);
+    }
+
+    // draws only the meshes whose bounds, placed with modelMatrix, touch the frustum; returns how many were drawn
+    unsigned int Draw(Shader &shader, const FrustumPlanes &frustum, const glm::mat4 &modelMatrix)
+    {
+        unsigned int drawn = 0;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            glm::vec3 center, extents;
+            transformAABB(modelMatrix, meshes[i].GetAABBCenter(), meshes[i].GetAABBExtents(), center, extents);
+            if(!frustum.isAABBVisible(center, extents))
+                continue;
+            meshes[i].Draw(shader);
+            drawn++;
+        }
+        return drawn;
+    }
     
 	auto& GetBoneInfoMap() { return m_BoneInfoMap; }
 	int& GetBoneCount() { return m_BoneCounter; }
+
+	// Conservative object-space AABB of the skinned mesh for the given palette (Animator::GetFinalBoneMatrices()).
+	// A skinned vertex is a weighted average of its bones' transforms, so it lies inside the union of the per-bone
+	// bind-pose boxes moved by their palette matrices. Returns false for models without any vertices.
+	bool ComputeAnimatedAABB(const std::vector<glm::mat4>& palette, glm::vec3& outMin, glm::vec3& outMax) const
+	{
+		outMin = glm::vec3(std::numeric_limits<float>::max());
+		outMax = glm::vec3(std::numeric_limits<float>::lowest());
+		bool any = false;
+
+		auto addBox = [&](const glm::mat4& m, const BoneBounds& box)
+		{
+			glm::vec3 center, extents;
+			transformAABB(m, (box.min + box.max) * 0.5f, (box.max - box.min) * 0.5f, center, extents);
+			outMin = glm::min(outMin, center - extents);
+			outMax = glm::max(outMax, center + extents);
+			any = true;
+		};
+
+		for (size_t id = 0; id < m_BoneBounds.size(); id++)
+		{
+			if (!m_BoneBounds[id].valid)
+				continue;
+			// bones past the palette are drawn in bind pose by the shader
+			addBox(id < palette.size() ? palette[id] : glm::mat4(1.0f), m_BoneBounds[id]);
+		}
+		if (m_UnskinnedBounds.valid)
+			addBox(glm::mat4(1.0f), m_UnskinnedBounds);
+		return any;
+	}
 	
 
 private:
@@ -57,8 +173,61 @@ private:
 	std::map<string, BoneInfo> m_BoneInfoMap;
 	int m_BoneCounter = 0;
 
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+	// bind-pose box of the vertices each bone influences, indexed by bone id
+	struct BoneBounds
+	{
+		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+		bool valid = false;
+
+		void grow(const glm::vec3& p)
+		{
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+			valid = true;
+		}
+	};
+	std::vector<BoneBounds> m_BoneBounds;
+	// vertices without any bone
+	BoneBounds m_UnskinnedBounds;
+
+	// what Import() prepared for Upload(); textures are deduplicated by path, meshes refer to them by index
+	struct PendingTexture
+	{
+		string path;
+		string type;
+		TextureCookKind kind;
+		CookedTexture cooked; // whole mip chain, empty when streamed or the image couldn't be cooked
+	};
+	struct PendingMesh
+	{
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		vector<size_t> textures;
+	};
+	vector<PendingTexture> m_PendingTextures;
+	vector<PendingMesh> m_PendingMeshes;
+
+    // model bounds from the meshes' own bounds, no vertex loop
+    void computeBounds()
+    {
+        if (meshes.empty())
+            return;
+        aabbMin = glm::vec3(std::numeric_limits<float>::max());
+        aabbMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const Mesh& mesh : meshes)
+        {
+            aabbMin = glm::min(aabbMin, mesh.aabbMin);
+            aabbMax = glm::max(aabbMax, mesh.aabbMax);
+        }
+        sphereCenter = (aabbMin + aabbMax) * 0.5f;
+        sphereRadius = 0.0f;
+        for (const Mesh& mesh : meshes)
+            sphereRadius = std::max(sphereRadius, glm::length(mesh.sphereCenter - sphereCenter) + mesh.sphereRadius);
+    }
+
+    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes for Upload().
+    bool loadModel(string const &path)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
@@ -67,13 +236,14 @@ private:
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return false;
         }
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+        return true;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -85,7 +255,7 @@ private:
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            m_PendingMeshes.push_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
@@ -105,11 +275,12 @@ private:
 	}
 
 
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+	PendingMesh processMesh(aiMesh* mesh, const aiScene* scene)
 	{
-		vector<Vertex> vertices;
-		vector<unsigned int> indices;
-		vector<Texture> textures;
+		PendingMesh result;
+		vector<Vertex>& vertices = result.vertices;
+		vector<unsigned int>& indices = result.indices;
+		vector<size_t>& textures = result.textures;
 
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 		{
@@ -138,18 +309,18 @@ private:
 		}
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
-		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+		vector<size_t> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
 		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+		vector<size_t> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
 		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+		std::vector<size_t> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
 		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-		std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+		std::vector<size_t> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 		ExtractBoneWeightForVertices(vertices,mesh,scene);
 
-		return Mesh(vertices, indices, textures);
+		return result;
 	}
 
 	void SetVertexBoneData(Vertex& vertex, int boneID, float weight)
@@ -192,14 +363,25 @@ private:
 			auto weights = mesh->mBones[boneIndex]->mWeights;
 			int numWeights = mesh->mBones[boneIndex]->mNumWeights;
 
+			if (boneID >= static_cast<int>(m_BoneBounds.size()))
+				m_BoneBounds.resize(boneID + 1);
+
 			for (int weightIndex = 0; weightIndex < numWeights; ++weightIndex)
 			{
 				int vertexId = weights[weightIndex].mVertexId;
 				float weight = weights[weightIndex].mWeight;
 				assert(vertexId <= vertices.size());
 				SetVertexBoneData(vertices[vertexId], boneID, weight);
+				if (weight > 0.0f)
+					m_BoneBounds[boneID].grow(vertices[vertexId].Position);
 			}
 		}
+
+		for (const Vertex& vertex : vertices)
+		{
+			if (vertex.m_BoneIDs[0] < 0)
+				m_UnskinnedBounds.grow(vertex.Position);
+		}
 	}
 
 
@@ -243,38 +425,59 @@ private:
 		return textureID;
 	}
     
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // checks all material textures of a given type and prepares the textures if they're not prepared yet.
+    // returns their indices in m_PendingTextures, which become indices in textures_loaded after Upload().
+    vector<size_t> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
-        vector<Texture> textures;
+        vector<size_t> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
+            // check if texture was prepared before and if so, continue to next iteration: skip loading a new texture
             bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            for(size_t j = 0; j < m_PendingTextures.size(); j++)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                if(std::strcmp(m_PendingTextures[j].path.data(), str.C_Str()) == 0)
                 {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
+                    textures.push_back(j);
+                    skip = true; // a texture with the same filepath has already been prepared, continue to next one. (optimization)
                     break;
                 }
             }
             if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
+            {   // if texture hasn't been prepared already, read its cooked cache
+                PendingTexture texture;
                 texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+                texture.type = typeName;
+                texture.kind = typeName == "texture_normal" ? TEXTURE_COOK_NORMAL : TEXTURE_COOK_COLOR;
+                prepareTexture(texture);
+                textures.push_back(m_PendingTextures.size());
+                m_PendingTextures.push_back(std::move(texture));
             }
         }
         return textures;
     }
+
+    // the file work of CookedTextureFromFile / TextureStreamer::load: cooks a stale cache and, unless streamed,
+    // reads the whole chain so Upload() only has to hand it to GL
+    void prepareTexture(PendingTexture &texture)
+    {
+        const string filename = this->directory + '/' + texture.path;
+        const bool fresh = IsCookedTextureFresh(filename, texture.kind);
+        if (textureStreamer)
+        {
+            if (!fresh)
+                CookTexture(filename, texture.kind, texture.cooked);
+            texture.cooked = CookedTexture(); // the streamer reads what it needs from the cache
+            return;
+        }
+        if (!(fresh && ReadCookedTexture(CookedTexturePath(filename, texture.kind), texture.cooked)))
+        {
+            texture.cooked = CookedTexture();
+            CookTexture(filename, texture.kind, texture.cooked);
+        }
+    }
 };
 
 
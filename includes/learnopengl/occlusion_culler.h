@@ -0,0 +1,452 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <immintrin.h>
+#define OCCLUSION_CULLER_USE_SSE 1
+#endif
+
+struct OcclusionStats
+{
+	unsigned int occluders = 0;
+	unsigned int triangles = 0;      // occluder triangles that reached the rasterizer
+	unsigned int tested = 0;
+	unsigned int occluded = 0;
+	double rasterMilliseconds = 0.0; // setup + rasterization + pyramid
+	double testMilliseconds = 0.0;   // summed over all isOccluded() calls, whichever thread made them
+};
+
+// Software hierarchical-Z occlusion culling.
+// A few designated occluder meshes (walls, terrain, big props) are rasterized on the CPU into a small depth buffer,
+// tile by tile on the thread pool, 4 pixels at a time with SSE. A min/max depth pyramid is built on top, and
+// isOccluded() tests a world AABB against the pyramid level where its screen rect covers at most 2x2 texels.
+// Depth is NDC z mapped to [0, 1], cleared to 1.
+//
+// Per frame: beginFrame, addOccluder..., render or renderAsync (runs next to simulation), then isOccluded from any thread.
+class SoftwareOcclusionCuller
+{
+public:
+	static const int TILE_SIZE = 32;
+
+	SoftwareOcclusionCuller(int width = 256, int height = 128)
+	{
+		m_Width = std::max(TILE_SIZE, (width + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE);
+		m_Height = std::max(TILE_SIZE, (height + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE);
+		m_TilesX = m_Width / TILE_SIZE;
+		m_TilesY = m_Height / TILE_SIZE;
+		m_Depth.assign(m_Width * m_Height, 1.0f);
+		m_Bins.resize(m_TilesX * m_TilesY);
+
+		// pyramid down to 1x1, level 0 is the full-resolution buffer
+		int levelWidth = m_Width, levelHeight = m_Height;
+		for (;;)
+		{
+			DepthLevel level;
+			level.width = levelWidth;
+			level.height = levelHeight;
+			level.minDepth.assign(levelWidth * levelHeight, 1.0f);
+			level.maxDepth.assign(levelWidth * levelHeight, 1.0f);
+			m_Levels.push_back(std::move(level));
+			if (levelWidth == 1 && levelHeight == 1)
+				break;
+			levelWidth = std::max(1, (levelWidth + 1) / 2);
+			levelHeight = std::max(1, (levelHeight + 1) / 2);
+		}
+	}
+
+	// forgets last frame's occluders; viewProjection is used for both rasterization and tests
+	void beginFrame(const glm::mat4& viewProjection)
+	{
+		m_ViewProjection = viewProjection;
+		m_Occluders.clear();
+		m_Stats = OcclusionStats();
+		m_Tested = 0;
+		m_Occluded = 0;
+		m_TestNanoseconds = 0;
+	}
+
+	// positions are read with the given byte stride; the data must stay alive until render() returns
+	void addOccluder(const float* positions, size_t stride, const unsigned int* indices, size_t indexCount, const glm::mat4& model)
+	{
+		Occluder occluder;
+		occluder.positions = reinterpret_cast<const uint8_t*>(positions);
+		occluder.stride = stride;
+		occluder.indices = indices;
+		occluder.indexCount = indexCount;
+		occluder.model = model;
+		m_Occluders.push_back(occluder);
+	}
+
+	void addOccluder(const Mesh& mesh, const glm::mat4& model)
+	{
+		if (mesh.vertices.empty() || mesh.indices.empty())
+			return;
+		addOccluder(&mesh.vertices[0].Position.x, sizeof(Vertex), mesh.indices.data(), mesh.indices.size(), model);
+	}
+
+	// any model with a public meshes array (Model from model.h or model_animation.h)
+	template<typename ModelType>
+	void addOccluderModel(const ModelType& occluderModel, const glm::mat4& model)
+	{
+		for (const Mesh& mesh : occluderModel.meshes)
+			addOccluder(mesh, model);
+	}
+
+	// rasterizes the occluders and builds the pyramid; tiles and pyramid rows are spread across the pool
+	void render(ThreadPool& pool = ThreadPool::global())
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		setupTriangles();
+		pool.parallelFor(m_Bins.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t tile = begin; tile < end; tile++)
+				rasterizeTile(static_cast<int>(tile));
+		});
+		buildPyramid(pool);
+
+		const auto stop = std::chrono::high_resolution_clock::now();
+		m_Stats.occluders = static_cast<unsigned int>(m_Occluders.size());
+		m_Stats.triangles = static_cast<unsigned int>(m_Triangles.size());
+		m_Stats.rasterMilliseconds = std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+
+	// runs render() as a pool task so the calling thread can update animation and transforms meanwhile;
+	// wait on the future before the first isOccluded()
+	std::future<void> renderAsync(ThreadPool& pool = ThreadPool::global())
+	{
+		return pool.submit([this, &pool] { render(pool); });
+	}
+
+	// true when the world-space box lies completely behind the occluders. Boxes crossing the near plane or
+	// outside the screen are never reported occluded, frustum culling handles those.
+	bool isOccluded(const glm::vec3& center, const glm::vec3& extents) const
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		const bool occluded = testAABB(center, extents);
+		const auto stop = std::chrono::high_resolution_clock::now();
+
+		m_Tested.fetch_add(1, std::memory_order_relaxed);
+		if (occluded)
+			m_Occluded.fetch_add(1, std::memory_order_relaxed);
+		m_TestNanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()), std::memory_order_relaxed);
+		return occluded;
+	}
+
+	OcclusionStats getStats() const
+	{
+		OcclusionStats stats = m_Stats;
+		stats.tested = m_Tested.load();
+		stats.occluded = m_Occluded.load();
+		stats.testMilliseconds = m_TestNanoseconds.load() / 1000000.0;
+		return stats;
+	}
+
+	// full-resolution occluder depth, e.g. to upload as a debug texture
+	const float* depthBuffer() const { return m_Depth.data(); }
+	int width() const { return m_Width; }
+	int height() const { return m_Height; }
+
+private:
+	struct Occluder
+	{
+		const uint8_t* positions;
+		size_t stride;
+		const unsigned int* indices;
+		size_t indexCount;
+		glm::mat4 model;
+	};
+
+	// screen-space triangle, counter-clockwise after setup
+	struct ScreenTriangle
+	{
+		float x[3], y[3], z[3];
+		int minX, minY, maxX, maxY; // inclusive pixel bounds
+	};
+
+	struct DepthLevel
+	{
+		int width, height;
+		std::vector<float> minDepth; // nearest occluder depth in the texel's footprint
+		std::vector<float> maxDepth; // farthest
+	};
+
+	// clip-space w below which a vertex counts as behind the camera
+	static constexpr float NEAR_W = 1e-4f;
+	// keeps surfaces lying right on an occluder (and the occluder's own bounds) visible
+	static constexpr float DEPTH_BIAS = 1e-5f;
+
+	void setupTriangles()
+	{
+		m_Triangles.clear();
+		for (std::vector<uint32_t>& bin : m_Bins)
+			bin.clear();
+		std::fill(m_Depth.begin(), m_Depth.end(), 1.0f);
+
+		std::vector<glm::vec4> clip;
+		for (const Occluder& occluder : m_Occluders)
+		{
+			const glm::mat4 mvp = m_ViewProjection * occluder.model;
+			// each vertex once; indexed meshes reference most of them several times
+			size_t numVertices = 0;
+			for (size_t i = 0; i < occluder.indexCount; i++)
+				numVertices = std::max<size_t>(numVertices, occluder.indices[i] + 1);
+			clip.resize(numVertices);
+			for (size_t v = 0; v < numVertices; v++)
+			{
+				const float* p = reinterpret_cast<const float*>(occluder.positions + v * occluder.stride);
+				clip[v] = mvp * glm::vec4(p[0], p[1], p[2], 1.0f);
+			}
+
+			for (size_t i = 0; i + 2 < occluder.indexCount; i += 3)
+			{
+				const glm::vec4& a = clip[occluder.indices[i]];
+				const glm::vec4& b = clip[occluder.indices[i + 1]];
+				const glm::vec4& c = clip[occluder.indices[i + 2]];
+				// dropping an occluder triangle is always safe, so skip the near-plane clipping
+				if (a.w < NEAR_W || b.w < NEAR_W || c.w < NEAR_W)
+					continue;
+				addTriangle(a, b, c);
+			}
+		}
+	}
+
+	void addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+	{
+		ScreenTriangle tri;
+		const glm::vec4* vertices[3] = { &a, &b, &c };
+		for (int i = 0; i < 3; i++)
+		{
+			const glm::vec4& v = *vertices[i];
+			tri.x[i] = (v.x / v.w * 0.5f + 0.5f) * m_Width;
+			tri.y[i] = (v.y / v.w * 0.5f + 0.5f) * m_Height;
+			tri.z[i] = v.z / v.w * 0.5f + 0.5f;
+		}
+
+		// both windings are rasterized, so occluders don't need to be closed
+		const float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+		if (std::abs(area) < 1e-8f)
+			return;
+		if (area < 0.0f)
+		{
+			std::swap(tri.x[1], tri.x[2]);
+			std::swap(tri.y[1], tri.y[2]);
+			std::swap(tri.z[1], tri.z[2]);
+		}
+
+		const float minX = std::min({ tri.x[0], tri.x[1], tri.x[2] });
+		const float maxX = std::max({ tri.x[0], tri.x[1], tri.x[2] });
+		const float minY = std::min({ tri.y[0], tri.y[1], tri.y[2] });
+		const float maxY = std::max({ tri.y[0], tri.y[1], tri.y[2] });
+		if (maxX < 0.0f || maxY < 0.0f || minX >= m_Width || minY >= m_Height)
+			return;
+		tri.minX = std::max(0, static_cast<int>(std::floor(minX)));
+		tri.minY = std::max(0, static_cast<int>(std::floor(minY)));
+		tri.maxX = std::min(m_Width - 1, static_cast<int>(std::ceil(maxX)));
+		tri.maxY = std::min(m_Height - 1, static_cast<int>(std::ceil(maxY)));
+
+		const uint32_t index = static_cast<uint32_t>(m_Triangles.size());
+		m_Triangles.push_back(tri);
+		for (int tileY = tri.minY / TILE_SIZE; tileY <= tri.maxY / TILE_SIZE; tileY++)
+		{
+			for (int tileX = tri.minX / TILE_SIZE; tileX <= tri.maxX / TILE_SIZE; tileX++)
+				m_Bins[tileY * m_TilesX + tileX].push_back(index);
+		}
+	}
+
+	// each tile only writes its own pixels, so tiles run in parallel without locking
+	void rasterizeTile(int tile)
+	{
+		const int tileMinX = (tile % m_TilesX) * TILE_SIZE;
+		const int tileMinY = (tile / m_TilesX) * TILE_SIZE;
+
+		for (uint32_t index : m_Bins[tile])
+		{
+			const ScreenTriangle& tri = m_Triangles[index];
+			const int minX = std::max(tri.minX, tileMinX) & ~3;
+			const int minY = std::max(tri.minY, tileMinY);
+			const int maxX = std::min(tri.maxX, tileMinX + TILE_SIZE - 1);
+			const int maxY = std::min(tri.maxY, tileMinY + TILE_SIZE - 1);
+
+			// edge functions E(x, y) = A x + B y + C, positive inside
+			float edgeA[3], edgeB[3], edgeC[3];
+			for (int e = 0; e < 3; e++)
+			{
+				const int next = (e + 1) % 3;
+				edgeA[e] = tri.y[e] - tri.y[next];
+				edgeB[e] = tri.x[next] - tri.x[e];
+				edgeC[e] = -edgeA[e] * tri.x[e] - edgeB[e] * tri.y[e];
+			}
+			// depth plane z = z0 + dzdx (x - x0) + dzdy (y - y0)
+			const float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+			const float dzdx = ((tri.z[1] - tri.z[0]) * (tri.y[2] - tri.y[0]) - (tri.z[2] - tri.z[0]) * (tri.y[1] - tri.y[0])) / area;
+			const float dzdy = ((tri.z[2] - tri.z[0]) * (tri.x[1] - tri.x[0]) - (tri.z[1] - tri.z[0]) * (tri.x[2] - tri.x[0])) / area;
+			const float dzC = tri.z[0] - dzdx * tri.x[0] - dzdy * tri.y[0];
+
+			for (int y = minY; y <= maxY; y++)
+			{
+				const float py = y + 0.5f;
+				float* row = &m_Depth[y * m_Width];
+				int x = minX;
+#if defined(OCCLUSION_CULLER_USE_SSE)
+				const __m128 rowE0 = _mm_set1_ps(edgeB[0] * py + edgeC[0]);
+				const __m128 rowE1 = _mm_set1_ps(edgeB[1] * py + edgeC[1]);
+				const __m128 rowE2 = _mm_set1_ps(edgeB[2] * py + edgeC[2]);
+				const __m128 rowZ = _mm_set1_ps(dzdy * py + dzC);
+				const __m128 zero = _mm_setzero_ps();
+				// rows are a multiple of TILE_SIZE wide and minX is 4-aligned, so groups never leave the tile
+				for (; x <= maxX; x += 4)
+				{
+					const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+					const __m128 e0 = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(edgeA[0])), rowE0);
+					const __m128 e1 = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(edgeA[1])), rowE1);
+					const __m128 e2 = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(edgeA[2])), rowE2);
+					const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+					if (_mm_movemask_ps(inside) == 0)
+						continue;
+
+					const __m128 z = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(dzdx)), rowZ);
+					const __m128 depth = _mm_loadu_ps(row + x);
+					const __m128 nearest = _mm_min_ps(depth, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth)));
+				}
+#endif
+				for (; x <= maxX; x++)
+				{
+					const float px = x + 0.5f;
+					if (edgeA[0] * px + edgeB[0] * py + edgeC[0] < 0.0f ||
+						edgeA[1] * px + edgeB[1] * py + edgeC[1] < 0.0f ||
+						edgeA[2] * px + edgeB[2] * py + edgeC[2] < 0.0f)
+						continue;
+					row[x] = std::min(row[x], dzdx * px + dzdy * py + dzC);
+				}
+			}
+		}
+	}
+
+	void buildPyramid(ThreadPool& pool)
+	{
+		m_Levels[0].minDepth = m_Depth;
+		m_Levels[0].maxDepth = m_Depth;
+
+		for (size_t l = 1; l < m_Levels.size(); l++)
+		{
+			const DepthLevel& src = m_Levels[l - 1];
+			DepthLevel& dst = m_Levels[l];
+			pool.parallelFor(dst.height, 16, [&](size_t begin, size_t end)
+			{
+				for (int y = static_cast<int>(begin); y < static_cast<int>(end); y++)
+				{
+					const int y0 = std::min(2 * y, src.height - 1) * src.width;
+					const int y1 = std::min(2 * y + 1, src.height - 1) * src.width;
+					for (int x = 0; x < dst.width; x++)
+					{
+						const int x0 = std::min(2 * x, src.width - 1);
+						const int x1 = std::min(2 * x + 1, src.width - 1);
+						dst.minDepth[y * dst.width + x] = std::min(std::min(src.minDepth[y0 + x0], src.minDepth[y0 + x1]),
+							std::min(src.minDepth[y1 + x0], src.minDepth[y1 + x1]));
+						dst.maxDepth[y * dst.width + x] = std::max(std::max(src.maxDepth[y0 + x0], src.maxDepth[y0 + x1]),
+							std::max(src.maxDepth[y1 + x0], src.maxDepth[y1 + x1]));
+					}
+				}
+			});
+		}
+	}
+
+	bool testAABB(const glm::vec3& center, const glm::vec3& extents) const
+	{
+		float minX = std::numeric_limits<float>::max(), minY = minX, minZ = minX;
+		float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			const glm::vec3 sign((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+			const glm::vec4 clip = m_ViewProjection * glm::vec4(center + sign * extents, 1.0f);
+			if (clip.w < NEAR_W)
+				return false;
+			const float invW = 1.0f / clip.w;
+			minX = std::min(minX, clip.x * invW);
+			maxX = std::max(maxX, clip.x * invW);
+			minY = std::min(minY, clip.y * invW);
+			maxY = std::max(maxY, clip.y * invW);
+			minZ = std::min(minZ, clip.z * invW);
+		}
+
+		int x0 = std::max(0, static_cast<int>(std::floor((minX * 0.5f + 0.5f) * m_Width)));
+		int y0 = std::max(0, static_cast<int>(std::floor((minY * 0.5f + 0.5f) * m_Height)));
+		int x1 = std::min(m_Width - 1, static_cast<int>(std::ceil((maxX * 0.5f + 0.5f) * m_Width)));
+		int y1 = std::min(m_Height - 1, static_cast<int>(std::ceil((maxY * 0.5f + 0.5f) * m_Height)));
+		if (x0 > x1 || y0 > y1)
+			return false;
+		const float nearestDepth = minZ * 0.5f + 0.5f - DEPTH_BIAS;
+
+		// coarsest useful level: the rect covers at most 2x2 texels
+		int level = 0;
+		while (level + 1 < static_cast<int>(m_Levels.size()) && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+			level++;
+
+		float regionMin = 1.0f, regionMax = 0.0f;
+		sampleRegion(level, x0, y0, x1, y1, regionMin, regionMax);
+		// behind the farthest occluder texel
+		if (nearestDepth > regionMax)
+			return true;
+		// in front of the nearest one
+		if (nearestDepth <= regionMin)
+			return false;
+
+		// partly covered: check texel by texel two levels finer
+		const int fine = std::max(0, level - 2);
+		const DepthLevel& fineLevel = m_Levels[fine];
+		for (int y = y0 >> fine; y <= (y1 >> fine); y++)
+		{
+			for (int x = x0 >> fine; x <= (x1 >> fine); x++)
+			{
+				if (nearestDepth <= fineLevel.maxDepth[y * fineLevel.width + x])
+					return false;
+			}
+		}
+		return true;
+	}
+
+	void sampleRegion(int level, int x0, int y0, int x1, int y1, float& outMin, float& outMax) const
+	{
+		const DepthLevel& depth = m_Levels[level];
+		for (int y = y0 >> level; y <= (y1 >> level); y++)
+		{
+			for (int x = x0 >> level; x <= (x1 >> level); x++)
+			{
+				outMin = std::min(outMin, depth.minDepth[y * depth.width + x]);
+				outMax = std::max(outMax, depth.maxDepth[y * depth.width + x]);
+			}
+		}
+	}
+
+	int m_Width, m_Height;
+	int m_TilesX, m_TilesY;
+	glm::mat4 m_ViewProjection = glm::mat4(1.0f);
+
+	std::vector<Occluder> m_Occluders;
+	std::vector<ScreenTriangle> m_Triangles;
+	std::vector<std::vector<uint32_t>> m_Bins; // triangle indices per tile
+	std::vector<float> m_Depth;
+	std::vector<DepthLevel> m_Levels;
+
+	OcclusionStats m_Stats;
+	mutable std::atomic<unsigned int> m_Tested{ 0 };
+	mutable std::atomic<unsigned int> m_Occluded{ 0 };
+	mutable std::atomic<uint64_t> m_TestNanoseconds{ 0 };
+};
+#endif
@@ -0,0 +1,461 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/ring_buffer.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/texture_streamer.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// Sort key layout, most significant first:
+//   4 bits pass | 12 bits program | 16 bits material | 16 bits VAO | 3 bits LOD | 13 bits depth
+// so draws end up grouped by pass, then program, then texture set, then vertex array, then level of detail (the
+// instancing groups), then front-to-back.
+enum RenderPass : uint64_t
+{
+	RENDER_PASS_OPAQUE = 0,
+	RENDER_PASS_TRANSPARENT = 1
+};
+
+struct DrawItem
+{
+	uint64_t key;
+	uint32_t index; // into RenderQueue's payload array
+};
+
+struct DrawPayload
+{
+	const Mesh* mesh;
+	Shader* shader;
+	glm::mat4 model;
+	unsigned int lod; // clamped index into mesh->lods
+};
+
+struct RenderStats
+{
+	unsigned int draws = 0;
+	unsigned int instancedDraws = 0;
+	unsigned int instances = 0;
+	unsigned int programSwitches = 0;
+	unsigned int textureBinds = 0;
+	unsigned int vaoBinds = 0;
+	unsigned int uniformUploads = 0;
+};
+
+class RenderQueue
+{
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 16;
+	// first attribute location of the per-instance model matrix (see anim_model_instanced.vs)
+	static const unsigned int INSTANCE_MATRIX_LOCATION = 7;
+
+	~RenderQueue()
+	{
+		if (m_InstanceVBO)
+			glDeleteBuffers(1, &m_InstanceVBO);
+	}
+
+	// draws pushed with shader are collapsed into glDrawElementsInstanced calls using instancedShader
+	// whenever at least minInstances visible items share a mesh. All instances of a group share the
+	// other uniforms (bone palette included), so only register variants for entities that may share them.
+	void setInstancedVariant(Shader& shader, Shader& instancedShader, unsigned int minInstances = 2)
+	{
+		m_InstancedVariants[shader.ID] = { &instancedShader, std::max(2u, minInstances) };
+	}
+
+	// instance matrices are written into this ring instead of the queue's own orphaned buffer.
+	// The owner calls beginFrame()/endFrame() on it around the frame.
+	void setStreamBuffer(StreamRingBuffer* ring)
+	{
+		m_Ring = ring;
+	}
+
+	// every push() then requests its mesh's textures from streamer at the mesh's projected size.
+	// Call again when the projection or viewport changes; nullptr turns the feedback off.
+	void setTextureStreamer(TextureStreamer* streamer, const glm::mat4& projection, float viewportHeight)
+	{
+		m_Streamer = streamer;
+		// pixels covered by one unit at distance one
+		m_PixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+	}
+
+	// starts a new frame; view is used to compute the depth part of the sort key
+	void begin(const glm::mat4& view, float zFar = 100.0f)
+	{
+		m_View = view;
+		m_InvFar = 1.0f / zFar;
+		m_Items.clear();
+		m_Payloads.clear();
+	}
+
+	void push(const Mesh& mesh, Shader& shader, const glm::mat4& model, RenderPass pass = RENDER_PASS_OPAQUE, unsigned int lod = 0)
+	{
+		const float viewDepth = -(m_View * model[3]).z;
+		if (m_Streamer)
+			requestTextures(mesh, model);
+		uint64_t depth = static_cast<uint64_t>(glm::clamp(viewDepth * m_InvFar, 0.0f, 1.0f) * 8191.0f);
+		// transparent geometry has to go back-to-front
+		if (pass == RENDER_PASS_TRANSPARENT)
+			depth = 8191 - depth;
+		lod = std::min<unsigned int>(lod, static_cast<unsigned int>(mesh.lods.size()) - 1);
+
+		const uint64_t key = (static_cast<uint64_t>(pass) & 0xF) << 60 |
+			(static_cast<uint64_t>(programSlot(shader.ID)) & 0xFFF) << 48 |
+			(static_cast<uint64_t>(materialSlot(mesh)) & 0xFFFF) << 32 |
+			(static_cast<uint64_t>(mesh.VAO) & 0xFFFF) << 16 |
+			(static_cast<uint64_t>(lod) & 0x7) << 13 |
+			depth;
+
+		m_Items.push_back({ key, static_cast<uint32_t>(m_Payloads.size()) });
+		m_Payloads.push_back({ &mesh, &shader, model, lod });
+	}
+
+	// pushes every mesh of a model
+	template<typename TModel>
+	void pushModel(TModel& model, Shader& shader, const glm::mat4& modelMatrix, RenderPass pass = RENDER_PASS_OPAQUE, unsigned int lod = 0)
+	{
+		for (auto& mesh : model.meshes)
+			push(mesh, shader, modelMatrix, pass, lod);
+	}
+
+	// sorts the frame's items and issues them, skipping binds that would not change GL state
+	void flush()
+	{
+		sortItems();
+
+		m_Stats = RenderStats();
+		buildInstanceGroups();
+		unsigned int currentProgram = 0;
+		unsigned int currentVAO = 0;
+		const Mesh* currentMaterial = nullptr;
+		GLint modelLocation = -1;
+		unsigned int boundTextures[MAX_TEXTURE_UNITS] = {};
+		unsigned int activeUnit = 0;
+		glActiveTexture(GL_TEXTURE0);
+
+		for (size_t i = 0; i < m_Items.size(); i++)
+		{
+			const DrawItem& item = m_Items[i];
+			const DrawPayload& payload = m_Payloads[item.index];
+			const Mesh& mesh = *payload.mesh;
+			const Mesh::LOD& lod = mesh.lods[payload.lod];
+			const InstanceGroup* group = m_GroupAt[i] >= 0 ? &m_Groups[m_GroupAt[i]] : nullptr;
+			Shader* shader = group ? group->shader : payload.shader;
+
+			if (shader->ID != currentProgram)
+			{
+				currentProgram = shader->ID;
+				glUseProgram(currentProgram);
+				modelLocation = glGetUniformLocation(currentProgram, "model");
+				// sampler uniforms are per program, so they have to be pointed at the units again
+				currentMaterial = nullptr;
+				m_Stats.programSwitches++;
+			}
+
+			if (currentMaterial == nullptr || !sameTextures(*currentMaterial, mesh))
+			{
+				bindMaterial(mesh, currentProgram, boundTextures, activeUnit);
+				currentMaterial = &mesh;
+			}
+
+			if (mesh.VAO != currentVAO)
+			{
+				currentVAO = mesh.VAO;
+				glBindVertexArray(currentVAO);
+				m_Stats.vaoBinds++;
+			}
+
+			if (group)
+			{
+				pointInstanceAttributes(group->firstMatrix);
+				glDrawElementsInstanced(GL_TRIANGLES, lod.indexCount, mesh.indexType, mesh.IndexOffset(lod.firstIndex), group->count);
+				resetInstanceAttributes();
+				m_Stats.draws++;
+				m_Stats.instancedDraws++;
+				m_Stats.instances += group->count;
+				i += group->count - 1;
+				continue;
+			}
+
+			glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &payload.model[0][0]);
+			m_Stats.uniformUploads++;
+
+			glDrawElements(GL_TRIANGLES, lod.indexCount, mesh.indexType, mesh.IndexOffset(lod.firstIndex));
+			m_Stats.draws++;
+		}
+
+		glBindVertexArray(0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	size_t size() const { return m_Items.size(); }
+
+	// counters of the last flush()
+	const RenderStats& getStats() const { return m_Stats; }
+
+private:
+	struct InstancedVariant
+	{
+		Shader* shader;
+		unsigned int minInstances;
+	};
+
+	struct InstanceGroup
+	{
+		Shader* shader;
+		unsigned int firstMatrix;
+		unsigned int count;
+	};
+
+	// after sorting, items sharing a program and mesh are adjacent; turn long enough runs into groups
+	// and write their model matrices into the instance buffer
+	void buildInstanceGroups()
+	{
+		m_Groups.clear();
+		m_GroupAt.assign(m_Items.size(), -1);
+		m_InstanceMatrices.clear();
+
+		for (size_t begin = 0; begin < m_Items.size();)
+		{
+			const DrawPayload& first = m_Payloads[m_Items[begin].index];
+			size_t end = begin + 1;
+			while (end < m_Items.size() &&
+				m_Payloads[m_Items[end].index].mesh == first.mesh &&
+				m_Payloads[m_Items[end].index].lod == first.lod &&
+				m_Payloads[m_Items[end].index].shader == first.shader)
+				end++;
+
+			auto variant = m_InstancedVariants.find(first.shader->ID);
+			if (variant != m_InstancedVariants.end() && end - begin >= variant->second.minInstances)
+			{
+				m_GroupAt[begin] = static_cast<int>(m_Groups.size());
+				m_Groups.push_back({ variant->second.shader, static_cast<unsigned int>(m_InstanceMatrices.size()), static_cast<unsigned int>(end - begin) });
+				for (size_t i = begin; i < end; i++)
+					m_InstanceMatrices.push_back(m_Payloads[m_Items[i].index].model);
+			}
+			begin = end;
+		}
+
+		if (m_InstanceMatrices.empty())
+			return;
+
+		const size_t bytes = m_InstanceMatrices.size() * sizeof(glm::mat4);
+		if (m_Ring)
+		{
+			RingAllocation allocation = m_Ring->write(m_InstanceMatrices.data(), bytes, sizeof(glm::vec4));
+			if (allocation)
+			{
+				m_Ring->commit();
+				m_InstanceBuffer = m_Ring->buffer();
+				m_InstanceBaseOffset = allocation.offset;
+				return;
+			}
+			// segment too small this frame, the ring counts the overflow
+		}
+
+		if (!m_InstanceVBO)
+			glGenBuffers(1, &m_InstanceVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_InstanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, bytes, m_InstanceMatrices.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_InstanceBuffer = m_InstanceVBO;
+		m_InstanceBaseOffset = 0;
+	}
+
+	// GL 3.3 has no base instance, so the group's offset goes into the attribute pointers of the bound VAO instead
+	void pointInstanceAttributes(unsigned int firstMatrix)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+		const size_t base = m_InstanceBaseOffset + firstMatrix * sizeof(glm::mat4);
+		for (unsigned int column = 0; column < 4; column++)
+		{
+			const unsigned int location = INSTANCE_MATRIX_LOCATION + column;
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(base + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(location, 1);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// the mesh VAO is shared with plain Mesh::Draw calls, which must not see the instance attributes
+	void resetInstanceAttributes()
+	{
+		for (unsigned int column = 0; column < 4; column++)
+		{
+			const unsigned int location = INSTANCE_MATRIX_LOCATION + column;
+			glVertexAttribDivisor(location, 0);
+			glDisableVertexAttribArray(location);
+		}
+	}
+
+	// 8 bit LSD radix sort on the 64 bit keys, passes where every key has the same byte are skipped
+	void sortItems()
+	{
+		const size_t count = m_Items.size();
+		m_Scratch.resize(count);
+
+		DrawItem* src = m_Items.data();
+		DrawItem* dst = m_Scratch.data();
+		for (unsigned int shift = 0; shift < 64; shift += 8)
+		{
+			size_t histogram[256] = {};
+			for (size_t i = 0; i < count; i++)
+				histogram[(src[i].key >> shift) & 0xFF]++;
+
+			if (count == 0 || histogram[(src[0].key >> shift) & 0xFF] == count)
+				continue;
+
+			size_t offset = 0;
+			for (size_t& bucket : histogram)
+			{
+				const size_t n = bucket;
+				bucket = offset;
+				offset += n;
+			}
+			for (size_t i = 0; i < count; i++)
+				dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+			std::swap(src, dst);
+		}
+
+		if (src != m_Items.data())
+			m_Items.swap(m_Scratch);
+	}
+
+	static bool sameTextures(const Mesh& a, const Mesh& b)
+	{
+		if (a.textures.size() != b.textures.size())
+			return false;
+		for (size_t i = 0; i < a.textures.size(); i++)
+		{
+			if (a.textures[i].id != b.textures[i].id || a.textures[i].type != b.textures[i].type)
+				return false;
+		}
+		return true;
+	}
+
+	// same unit/sampler naming as Mesh::BindTextures, but only touches units whose texture changes
+	void bindMaterial(const Mesh& mesh, unsigned int program, unsigned int* boundTextures, unsigned int& activeUnit)
+	{
+		unsigned int diffuseNr = 1;
+		unsigned int specularNr = 1;
+		unsigned int normalNr = 1;
+		unsigned int heightNr = 1;
+		for (unsigned int i = 0; i < mesh.textures.size() && i < MAX_TEXTURE_UNITS; i++)
+		{
+			string number;
+			const string& name = mesh.textures[i].type;
+			if (name == "texture_diffuse")
+				number = std::to_string(diffuseNr++);
+			else if (name == "texture_specular")
+				number = std::to_string(specularNr++);
+			else if (name == "texture_normal")
+				number = std::to_string(normalNr++);
+			else if (name == "texture_height")
+				number = std::to_string(heightNr++);
+
+			glUniform1i(samplerLocation(program, name + number), i);
+
+			if (boundTextures[i] != mesh.textures[i].id)
+			{
+				if (activeUnit != i)
+				{
+					glActiveTexture(GL_TEXTURE0 + i);
+					activeUnit = i;
+				}
+				glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
+				boundTextures[i] = mesh.textures[i].id;
+				m_Stats.textureBinds++;
+			}
+		}
+	}
+
+	GLint samplerLocation(unsigned int program, const string& name)
+	{
+		auto& locations = m_SamplerLocations[program];
+		auto it = locations.find(name);
+		if (it != locations.end())
+			return it->second;
+		const GLint location = glGetUniformLocation(program, name.c_str());
+		locations[name] = location;
+		return location;
+	}
+
+	// the mesh's bounding sphere on screen, finest levels when the camera is inside it
+	void requestTextures(const Mesh& mesh, const glm::mat4& model)
+	{
+		const float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		const float radius = mesh.sphereRadius * scale;
+		const float depth = -(m_View * model * glm::vec4(mesh.sphereCenter, 1.0f)).z;
+		const float pixels = depth > radius ? 2.0f * radius * m_PixelsPerUnit / depth : 1e9f;
+		for (const Texture& texture : mesh.textures)
+			m_Streamer->request(texture.id, pixels);
+	}
+
+	// small dense ids so the key fields stay narrow
+	uint32_t programSlot(unsigned int program)
+	{
+		auto it = m_ProgramSlots.find(program);
+		if (it != m_ProgramSlots.end())
+			return it->second;
+		const uint32_t slot = static_cast<uint32_t>(m_ProgramSlots.size());
+		m_ProgramSlots[program] = slot;
+		return slot;
+	}
+
+	uint32_t materialSlot(const Mesh& mesh)
+	{
+		auto cached = m_MeshMaterials.find(&mesh);
+		if (cached != m_MeshMaterials.end())
+			return cached->second;
+
+		std::vector<unsigned int> signature;
+		for (const Texture& texture : mesh.textures)
+			signature.push_back(texture.id);
+
+		auto it = m_MaterialSlots.find(signature);
+		uint32_t slot;
+		if (it != m_MaterialSlots.end())
+			slot = it->second;
+		else
+		{
+			slot = static_cast<uint32_t>(m_MaterialSlots.size());
+			m_MaterialSlots[signature] = slot;
+		}
+		m_MeshMaterials[&mesh] = slot;
+		return slot;
+	}
+
+	glm::mat4 m_View = glm::mat4(1.0f);
+	float m_InvFar = 0.01f;
+	std::vector<DrawItem> m_Items;
+	std::vector<DrawItem> m_Scratch;
+	std::vector<DrawPayload> m_Payloads;
+
+	std::unordered_map<unsigned int, uint32_t> m_ProgramSlots;
+	std::unordered_map<const Mesh*, uint32_t> m_MeshMaterials;
+	std::map<std::vector<unsigned int>, uint32_t> m_MaterialSlots;
+	std::unordered_map<unsigned int, std::unordered_map<string, GLint>> m_SamplerLocations;
+
+	std::unordered_map<unsigned int, InstancedVariant> m_InstancedVariants;
+	std::vector<InstanceGroup> m_Groups;
+	std::vector<int> m_GroupAt;
+	std::vector<glm::mat4> m_InstanceMatrices;
+	unsigned int m_InstanceVBO = 0;
+	StreamRingBuffer* m_Ring = nullptr;
+	unsigned int m_InstanceBuffer = 0;
+	size_t m_InstanceBaseOffset = 0;
+
+	TextureStreamer* m_Streamer = nullptr;
+	float m_PixelsPerUnit = 0.0f;
+
+	RenderStats m_Stats;
+};
+#endif
@@ -0,0 +1,204 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct RingAllocation
+{
+	void* ptr = nullptr; // write-only, valid until the next beginFrame()
+	size_t offset = 0;   // byte offset inside buffer(), for attribute pointers / glBindBufferRange
+	size_t size = 0;
+
+	explicit operator bool() const { return ptr != nullptr; }
+};
+
+struct RingBufferStats
+{
+	unsigned int frames = 0;
+	unsigned int stalls = 0;      // beginFrame() had to wait for the GPU to release a segment
+	double stallMilliseconds = 0.0;
+	unsigned int overflows = 0;   // allocations that did not fit in a segment
+	size_t peakFrameBytes = 0;
+};
+
+// Triple-buffered streaming buffer for per-frame transient GPU data (instance matrices, bone palettes, debug lines).
+// The buffer is split into one segment per frame in flight. On GL 4.4 it is mapped once
+// persistently and a fence per segment keeps the CPU from overwriting data the GPU still reads; on plain GL 3.3
+// writes go to a CPU copy that commit() uploads into a freshly orphaned buffer.
+class StreamRingBuffer
+{
+public:
+	StreamRingBuffer(GLenum target, size_t segmentSize, unsigned int numSegments = 3)
+		: m_Target(target), m_SegmentSize(segmentSize), m_NumSegments(numSegments), m_Fences(numSegments, nullptr)
+	{
+		GLint alignment = 256;
+		if (target == GL_UNIFORM_BUFFER)
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		m_MinAlignment = static_cast<size_t>(alignment);
+		m_SegmentSize = alignUp(m_SegmentSize, m_MinAlignment);
+
+		glGenBuffers(1, &m_Buffer);
+		glBindBuffer(m_Target, m_Buffer);
+		m_Persistent = GLAD_GL_VERSION_4_4;
+		if (m_Persistent)
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(m_Target, totalSize(), NULL, flags);
+			m_Mapped = static_cast<uint8_t*>(glMapBufferRange(m_Target, 0, totalSize(), flags));
+			if (!m_Mapped)
+			{
+				// storage is immutable now, so start over with a mutable buffer
+				glBindBuffer(m_Target, 0);
+				glDeleteBuffers(1, &m_Buffer);
+				glGenBuffers(1, &m_Buffer);
+				glBindBuffer(m_Target, m_Buffer);
+				m_Persistent = false;
+			}
+		}
+		if (!m_Persistent)
+		{
+			glBufferData(m_Target, m_SegmentSize, NULL, GL_STREAM_DRAW);
+			m_Staging.resize(m_SegmentSize);
+		}
+		glBindBuffer(m_Target, 0);
+	}
+
+	~StreamRingBuffer()
+	{
+		for (GLsync fence : m_Fences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+		}
+		if (m_Mapped)
+		{
+			glBindBuffer(m_Target, m_Buffer);
+			glUnmapBuffer(m_Target);
+			glBindBuffer(m_Target, 0);
+		}
+		glDeleteBuffers(1, &m_Buffer);
+	}
+
+	StreamRingBuffer(const StreamRingBuffer&) = delete;
+	StreamRingBuffer& operator=(const StreamRingBuffer&) = delete;
+
+	// moves to the next segment, waiting for the GPU if it still reads it
+	void beginFrame()
+	{
+		m_Segment = (m_Segment + 1) % m_NumSegments;
+		m_Head = 0;
+		m_Stats.frames++;
+
+		GLsync& fence = m_Fences[m_Segment];
+		if (!fence)
+			return;
+
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			m_Stats.stalls++;
+			const auto start = std::chrono::high_resolution_clock::now();
+			do
+			{
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+			} while (result == GL_TIMEOUT_EXPIRED);
+			const auto stop = std::chrono::high_resolution_clock::now();
+			m_Stats.stallMilliseconds += std::chrono::duration<double, std::milli>(stop - start).count();
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// call after the last draw that reads this frame's data
+	void endFrame()
+	{
+		if (m_Persistent)
+			m_Fences[m_Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// reserves size bytes in the current segment; returns an empty allocation when the segment is full
+	RingAllocation allocate(size_t size, size_t alignment = 16)
+	{
+		const size_t start = alignUp(m_Head, std::max(alignment, m_Target == GL_UNIFORM_BUFFER ? m_MinAlignment : size_t(1)));
+		if (start + size > m_SegmentSize)
+		{
+			m_Stats.overflows++;
+			return RingAllocation();
+		}
+		m_Head = start + size;
+		m_Stats.peakFrameBytes = std::max(m_Stats.peakFrameBytes, m_Head);
+
+		RingAllocation allocation;
+		allocation.size = size;
+		if (m_Persistent)
+		{
+			allocation.offset = m_Segment * m_SegmentSize + start;
+			allocation.ptr = m_Mapped + allocation.offset;
+		}
+		else
+		{
+			allocation.offset = start;
+			allocation.ptr = m_Staging.data() + start;
+		}
+		return allocation;
+	}
+
+	// allocate + memcpy
+	RingAllocation write(const void* data, size_t size, size_t alignment = 16)
+	{
+		RingAllocation allocation = allocate(size, alignment);
+		if (allocation)
+			std::memcpy(allocation.ptr, data, size);
+		return allocation;
+	}
+
+	// makes everything written so far this frame visible to the GPU; call before drawing with it.
+	// Nothing to do for the coherent persistent mapping.
+	void commit()
+	{
+		if (m_Persistent || m_Head == 0)
+			return;
+		glBindBuffer(m_Target, m_Buffer);
+		glBufferData(m_Target, m_SegmentSize, NULL, GL_STREAM_DRAW);
+		glBufferSubData(m_Target, 0, m_Head, m_Staging.data());
+		glBindBuffer(m_Target, 0);
+	}
+
+	unsigned int buffer() const { return m_Buffer; }
+	bool isPersistent() const { return m_Persistent; }
+	size_t segmentSize() const { return m_SegmentSize; }
+
+	const RingBufferStats& getStats() const { return m_Stats; }
+	void resetStats() { m_Stats = RingBufferStats(); }
+
+private:
+	size_t totalSize() const { return m_SegmentSize * m_NumSegments; }
+
+	static size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	GLenum m_Target;
+	size_t m_SegmentSize;
+	unsigned int m_NumSegments;
+	size_t m_MinAlignment = 1;
+
+	unsigned int m_Buffer = 0;
+	bool m_Persistent = false;
+	uint8_t* m_Mapped = nullptr;
+	std::vector<uint8_t> m_Staging;
+	std::vector<GLsync> m_Fences;
+
+	unsigned int m_Segment = 0;
+	size_t m_Head = 0;
+
+	RingBufferStats m_Stats;
+};
+#endif
@@ -0,0 +1,242 @@
+#ifndef SKINNING_H
+#define SKINNING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <immintrin.h>
+#define SKINNING_USE_SSE 1
+#endif
+
+// must match MAX_BONES in anim_model.vs
+#define MAX_SKINNING_BONES 100
+
+// what gets streamed to the GPU per skinned vertex, everything else is read from the mesh's own VBO
+struct SkinnedVertex
+{
+	glm::vec3 Position;
+	glm::vec3 Normal;
+};
+
+struct SkinningStats
+{
+	size_t vertices = 0;
+	double milliseconds = 0.0;
+
+	double verticesPerMs() const { return milliseconds > 0.0 ? vertices / milliseconds : 0.0; }
+};
+
+// CPU-side skinned copy of one Mesh and the two streaming VBOs it is drawn from.
+// Each Upload() writes into the buffer the GPU did not read last frame.
+class SkinnedMeshStream
+{
+public:
+	const Mesh* mesh;
+	std::vector<SkinnedVertex> vertices;
+
+	SkinnedMeshStream(const Mesh& sourceMesh) : mesh(&sourceMesh), vertices(sourceMesh.vertices.size())
+	{
+		glGenVertexArrays(2, VAOs);
+		glGenBuffers(2, VBOs);
+
+		for (int i = 0; i < 2; i++)
+		{
+			glBindVertexArray(VAOs[i]);
+
+			glBindBuffer(GL_ARRAY_BUFFER, VBOs[i]);
+			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SkinnedVertex), NULL, GL_STREAM_DRAW);
+			// skinned positions and normals
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)0);
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, Normal));
+
+			// the rest comes straight from the static mesh buffer
+			glBindBuffer(GL_ARRAY_BUFFER, mesh->GetVBO());
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+			glEnableVertexAttribArray(4);
+			glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->GetEBO());
+		}
+		glBindVertexArray(0);
+	}
+
+	~SkinnedMeshStream()
+	{
+		glDeleteVertexArrays(2, VAOs);
+		glDeleteBuffers(2, VBOs);
+	}
+
+	SkinnedMeshStream(const SkinnedMeshStream&) = delete;
+	SkinnedMeshStream& operator=(const SkinnedMeshStream&) = delete;
+
+	// copies the current CPU result into the back buffer and makes it the one to draw
+	void Upload()
+	{
+		m_Current = 1 - m_Current;
+		glBindBuffer(GL_ARRAY_BUFFER, VBOs[m_Current]);
+		// orphan first so the driver never has to wait on a draw still reading the old contents
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SkinnedVertex), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(SkinnedVertex), vertices.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// draws with an unskinned vertex shader (see cpu_skinned.vs)
+	void Draw(Shader& shader)
+	{
+		mesh->BindTextures(shader);
+
+		glBindVertexArray(VAOs[m_Current]);
+		glDrawElements(GL_TRIANGLES, mesh->lods[0].indexCount, mesh->indexType, mesh->IndexOffset(mesh->lods[0].firstIndex));
+		glBindVertexArray(0);
+
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+private:
+	unsigned int VAOs[2];
+	unsigned int VBOs[2];
+	int m_Current = 0;
+};
+
+// Skins Mesh vertices on the CPU with the same linear blend the anim_model.vs shader uses.
+// Vertices are split in chunks across the thread pool; each vertex blends its bone matrices with SSE.
+// Vertices without any bone influence keep their bind pose.
+class CpuSkinner
+{
+public:
+	CpuSkinner(ThreadPool& pool = ThreadPool::global(), size_t grainSize = 4096)
+		: m_Pool(pool), m_GrainSize(grainSize)
+	{}
+
+	// skins mesh with the palette from Animator::GetFinalBoneMatrices() into out (one entry per mesh vertex)
+	void Skin(const Mesh& mesh, const std::vector<glm::mat4>& palette, SkinnedVertex* out)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		const Vertex* in = mesh.vertices.data();
+		const int paletteSize = static_cast<int>(std::min<size_t>(palette.size(), MAX_SKINNING_BONES));
+		m_Pool.parallelFor(mesh.vertices.size(), m_GrainSize, [&](size_t begin, size_t end)
+		{
+			SkinRange(in + begin, out + begin, end - begin, palette.data(), paletteSize);
+		});
+
+		const auto stop = std::chrono::high_resolution_clock::now();
+		m_Stats.vertices += mesh.vertices.size();
+		m_Stats.milliseconds += std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+
+	// skins into the stream's CPU copy and uploads it
+	void Skin(SkinnedMeshStream& stream, const std::vector<glm::mat4>& palette)
+	{
+		Skin(*stream.mesh, palette, stream.vertices.data());
+		stream.Upload();
+	}
+
+	// accumulated since the last ResetStats()
+	const SkinningStats& GetStats() const { return m_Stats; }
+	void ResetStats() { m_Stats = SkinningStats(); }
+
+	static void SkinRange(const Vertex* in, SkinnedVertex* out, size_t count, const glm::mat4* palette, int paletteSize)
+	{
+		for (size_t v = 0; v < count; v++)
+		{
+			const Vertex& vertex = in[v];
+
+#ifdef SKINNING_USE_SSE
+			// blended matrix, one column per register
+			__m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+			bool bindPose = true;
+			for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+			{
+				const int id = vertex.m_BoneIDs[i];
+				if (id < 0)
+					continue;
+				if (id >= paletteSize)
+				{
+					bindPose = true;
+					break;
+				}
+				bindPose = false;
+				const float* m = &palette[id][0][0];
+				const __m128 w = _mm_set1_ps(vertex.m_Weights[i]);
+				c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(m + 0), w));
+				c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(m + 4), w));
+				c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(m + 8), w));
+				c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(m + 12), w));
+			}
+
+			if (bindPose)
+			{
+				out[v].Position = vertex.Position;
+				out[v].Normal = vertex.Normal;
+				continue;
+			}
+
+			__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Position.x)),
+				_mm_mul_ps(c1, _mm_set1_ps(vertex.Position.y))),
+				_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(vertex.Position.z)), c3));
+			__m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Normal.x)),
+				_mm_mul_ps(c1, _mm_set1_ps(vertex.Normal.y))),
+				_mm_mul_ps(c2, _mm_set1_ps(vertex.Normal.z)));
+
+			float pf[4], nf[4];
+			_mm_storeu_ps(pf, p);
+			_mm_storeu_ps(nf, n);
+			out[v].Position = glm::vec3(pf[0], pf[1], pf[2]);
+			out[v].Normal = safeNormalize(glm::vec3(nf[0], nf[1], nf[2]), vertex.Normal);
+#else
+			glm::mat4 blended(0.0f);
+			bool bindPose = true;
+			for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+			{
+				const int id = vertex.m_BoneIDs[i];
+				if (id < 0)
+					continue;
+				if (id >= paletteSize)
+				{
+					bindPose = true;
+					break;
+				}
+				bindPose = false;
+				blended += palette[id] * vertex.m_Weights[i];
+			}
+
+			if (bindPose)
+			{
+				out[v].Position = vertex.Position;
+				out[v].Normal = vertex.Normal;
+				continue;
+			}
+
+			out[v].Position = glm::vec3(blended * glm::vec4(vertex.Position, 1.0f));
+			out[v].Normal = safeNormalize(glm::mat3(blended) * vertex.Normal, vertex.Normal);
+#endif
+		}
+	}
+
+private:
+	static glm::vec3 safeNormalize(const glm::vec3& n, const glm::vec3& fallback)
+	{
+		const float len2 = glm::dot(n, n);
+		return len2 > 1e-12f ? n * (1.0f / std::sqrt(len2)) : fallback;
+	}
+
+	ThreadPool& m_Pool;
+	size_t m_GrainSize;
+	SkinningStats m_Stats;
+};
+#endif
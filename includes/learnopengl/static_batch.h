@@ -0,0 +1,312 @@
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum_culler.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/texture_array.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+struct StaticBatchStats
+{
+	unsigned int cells = 0;
+	unsigned int visibleCells = 0;
+	unsigned int materials = 0;
+	unsigned int draws = 0;     // glMultiDrawElements calls, at most one per material (one in total with a MaterialTable)
+	unsigned int ranges = 0;    // index ranges in those calls after merging neighbours
+	unsigned int triangles = 0;
+};
+
+// Geometry that never moves, baked into one world-space vertex and index buffer.
+// Every mesh instance goes to the grid cell holding its world AABB center; the index buffer is ordered by
+// material, then cell, so each (material, cell) pair is one contiguous range. draw() frustum-culls the cells
+// and issues the visible ranges of each material in a single glMultiDrawElements, neighbouring ranges merged.
+// The vertex layout is Mesh's with bone IDs of -1, so draw with a shader that skips skinning (cpu_skinned.vs).
+// Built with a MaterialTable, textures come from texture arrays instead: every vertex carries its material index
+// (STATIC_BATCH_MATERIAL_LOCATION) and all visible cells go out in one draw, see material_array.vs / .fs.
+class StaticBatch
+{
+public:
+	static const unsigned int STATIC_BATCH_MATERIAL_LOCATION = 7;
+
+	explicit StaticBatch(float cellSize = 32.0f) : m_CellSize(cellSize) {}
+
+	~StaticBatch()
+	{
+		release();
+	}
+
+	StaticBatch(const StaticBatch&) = delete;
+	StaticBatch& operator=(const StaticBatch&) = delete;
+
+	// the mesh has to outlive the batch, its textures are what draw() binds for its material. Only meshes with
+	// CPU-side vertices and indices can be merged, meshes on an external VAO (glTF) are skipped.
+	void addMesh(const Mesh& mesh, const glm::mat4& modelMatrix)
+	{
+		if (!mesh.vertices.empty() && !mesh.indices.empty() && !mesh.lods.empty() && mesh.lods[0].indexCount > 0)
+			m_Sources.push_back({ &mesh, modelMatrix });
+	}
+
+	template<typename ModelType>
+	void addModel(const ModelType& model, const glm::mat4& modelMatrix)
+	{
+		for (const Mesh& mesh : model.meshes)
+			addMesh(mesh, modelMatrix);
+	}
+
+	// merges everything added since the last build, replacing the previous buffers.
+	// With materials, the meshes' texture sets are added to it and it is uploaded; it has to outlive the batch.
+	void build(MaterialTable* materials = nullptr)
+	{
+		release();
+		m_MaterialTable = materials;
+		std::vector<unsigned int> sourceMaterials(m_Sources.size(), 0);
+
+		// (material, cell) -> sources, ordered so materials and then cells are contiguous
+		std::map<std::vector<std::pair<std::string, unsigned int>>, unsigned int> materialIds;
+		std::map<std::tuple<unsigned int, int, int, int>, std::vector<size_t>> groups;
+		for (size_t i = 0; i < m_Sources.size(); i++)
+		{
+			const Mesh& mesh = *m_Sources[i].mesh;
+			std::vector<std::pair<std::string, unsigned int>> textures;
+			for (const Texture& texture : mesh.textures)
+				textures.emplace_back(texture.type, texture.id);
+			// with a material table everything shares one range list, the material index goes into the vertices
+			if (materials)
+			{
+				sourceMaterials[i] = materials->add(mesh.textures);
+				textures.clear();
+			}
+			const auto material = materialIds.emplace(textures, static_cast<unsigned int>(materialIds.size()));
+			if (material.second)
+				m_Materials.push_back({ materials ? nullptr : &mesh, 0, 0 });
+
+			glm::vec3 center, extents;
+			transformAABB(m_Sources[i].modelMatrix, mesh.GetAABBCenter(), mesh.GetAABBExtents(), center, extents);
+			const glm::ivec3 cell = glm::ivec3(glm::floor(center / m_CellSize));
+			groups[std::make_tuple(material.first->second, cell.x, cell.y, cell.z)].push_back(i);
+		}
+
+		std::vector<Vertex> vertices;
+		std::vector<int> vertexMaterials;
+		std::vector<unsigned int> indices;
+		std::map<std::tuple<int, int, int>, unsigned int> cellIds;
+		for (const auto& group : groups)
+		{
+			const unsigned int material = std::get<0>(group.first);
+			const auto cell = cellIds.emplace(std::make_tuple(std::get<1>(group.first), std::get<2>(group.first), std::get<3>(group.first)), static_cast<unsigned int>(m_Cells.size()));
+			if (cell.second)
+				m_Cells.push_back({ glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) });
+			Cell& bounds = m_Cells[cell.first->second];
+
+			Range range{ cell.first->second, static_cast<unsigned int>(indices.size()), 0 };
+			for (size_t source : group.second)
+			{
+				appendMesh(*m_Sources[source].mesh, m_Sources[source].modelMatrix, vertices, indices, bounds);
+				if (materials)
+					vertexMaterials.resize(vertices.size(), static_cast<int>(sourceMaterials[source]));
+			}
+			range.indexCount = static_cast<unsigned int>(indices.size()) - range.firstIndex;
+
+			if (m_Materials[material].rangeCount == 0)
+				m_Materials[material].firstRange = static_cast<unsigned int>(m_Ranges.size());
+			m_Materials[material].rangeCount++;
+			m_Ranges.push_back(range);
+		}
+		m_Sources.clear();
+		m_Sources.shrink_to_fit();
+		if (indices.empty())
+			return;
+
+		glGenVertexArrays(1, &m_VAO);
+		glGenBuffers(1, &m_VBO);
+		glGenBuffers(1, &m_EBO);
+		glBindVertexArray(m_VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+		// same attribute layout as Mesh::setupMesh
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+		glEnableVertexAttribArray(5);
+		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+		glEnableVertexAttribArray(6);
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+		if (materials)
+		{
+			glGenBuffers(1, &m_MaterialVBO);
+			glBindBuffer(GL_ARRAY_BUFFER, m_MaterialVBO);
+			glBufferData(GL_ARRAY_BUFFER, vertexMaterials.size() * sizeof(int), vertexMaterials.data(), GL_STATIC_DRAW);
+			glEnableVertexAttribArray(STATIC_BATCH_MATERIAL_LOCATION);
+			glVertexAttribIPointer(STATIC_BATCH_MATERIAL_LOCATION, 1, GL_INT, sizeof(int), (void*)0);
+			materials->upload();
+		}
+		glBindVertexArray(0);
+	}
+
+	// shader has to be in use with view and projection set; model is set to identity here
+	void draw(Shader& shader, const glm::mat4& viewProjection)
+	{
+		m_Stats = StaticBatchStats();
+		m_Stats.cells = static_cast<unsigned int>(m_Cells.size());
+		m_Stats.materials = static_cast<unsigned int>(m_Materials.size());
+		if (!m_VAO)
+			return;
+
+		const FrustumPlanes planes = FrustumPlanes::fromViewProjection(viewProjection);
+		m_CellVisible.resize(m_Cells.size());
+		for (size_t i = 0; i < m_Cells.size(); i++)
+		{
+			const Cell& cell = m_Cells[i];
+			m_CellVisible[i] = planes.isAABBVisible((cell.min + cell.max) * 0.5f, (cell.max - cell.min) * 0.5f);
+			m_Stats.visibleCells += m_CellVisible[i];
+		}
+
+		shader.setMat4("model", glm::mat4(1.0f));
+		if (m_MaterialTable)
+			m_MaterialTable->bind(shader);
+		glBindVertexArray(m_VAO);
+		for (const Material& material : m_Materials)
+		{
+			m_Counts.clear();
+			m_Offsets.clear();
+			unsigned int end = 0;
+			for (unsigned int r = material.firstRange; r < material.firstRange + material.rangeCount; r++)
+			{
+				const Range& range = m_Ranges[r];
+				if (!m_CellVisible[range.cell])
+					continue;
+				if (!m_Counts.empty() && end == range.firstIndex)
+					m_Counts.back() += range.indexCount;
+				else
+				{
+					m_Counts.push_back(static_cast<GLsizei>(range.indexCount));
+					m_Offsets.push_back((const void*)(static_cast<size_t>(range.firstIndex) * sizeof(unsigned int)));
+				}
+				end = range.firstIndex + range.indexCount;
+				m_Stats.triangles += range.indexCount / 3;
+			}
+			if (m_Counts.empty())
+				continue;
+
+			if (material.mesh)
+				material.mesh->BindTextures(shader);
+			glMultiDrawElements(GL_TRIANGLES, m_Counts.data(), GL_UNSIGNED_INT, m_Offsets.data(), static_cast<GLsizei>(m_Counts.size()));
+			m_Stats.draws++;
+			m_Stats.ranges += static_cast<unsigned int>(m_Counts.size());
+		}
+		glBindVertexArray(0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	const StaticBatchStats& getStats() const { return m_Stats; }
+
+	// drops the GPU buffers and the cell layout, added but not yet built meshes are kept
+	void release()
+	{
+		if (m_VAO)
+		{
+			glDeleteBuffers(1, &m_EBO);
+			glDeleteBuffers(1, &m_VBO);
+			glDeleteVertexArrays(1, &m_VAO);
+		}
+		if (m_MaterialVBO)
+			glDeleteBuffers(1, &m_MaterialVBO);
+		m_VAO = m_VBO = m_EBO = m_MaterialVBO = 0;
+		m_MaterialTable = nullptr;
+		m_Cells.clear();
+		m_Ranges.clear();
+		m_Materials.clear();
+	}
+
+private:
+	struct Source
+	{
+		const Mesh* mesh;
+		glm::mat4 modelMatrix;
+	};
+
+	struct Cell
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	struct Range
+	{
+		unsigned int cell;
+		unsigned int firstIndex;
+		unsigned int indexCount;
+	};
+
+	struct Material
+	{
+		const Mesh* mesh; // first mesh using the texture set, binds it; null with a material table
+		unsigned int firstRange;
+		unsigned int rangeCount;
+	};
+
+	// full-detail triangles of mesh moved to world space
+	static void appendMesh(const Mesh& mesh, const glm::mat4& modelMatrix, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, Cell& bounds)
+	{
+		const glm::mat3 basis(modelMatrix);
+		const glm::mat3 normalMatrix = glm::transpose(glm::inverse(basis));
+		const unsigned int baseVertex = static_cast<unsigned int>(vertices.size());
+		for (const Vertex& source : mesh.vertices)
+		{
+			Vertex vertex = source;
+			vertex.Position = glm::vec3(modelMatrix * glm::vec4(source.Position, 1.0f));
+			vertex.Normal = glm::normalize(normalMatrix * source.Normal);
+			vertex.Tangent = basis * source.Tangent;
+			vertex.Bitangent = basis * source.Bitangent;
+			for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+			{
+				vertex.m_BoneIDs[i] = -1;
+				vertex.m_Weights[i] = 0.0f;
+			}
+			bounds.min = glm::min(bounds.min, vertex.Position);
+			bounds.max = glm::max(bounds.max, vertex.Position);
+			vertices.push_back(vertex);
+		}
+
+		const Mesh::LOD& full = mesh.lods[0];
+		for (unsigned int i = full.firstIndex; i < full.firstIndex + full.indexCount; i++)
+			indices.push_back(baseVertex + mesh.indices[i]);
+	}
+
+	float m_CellSize;
+	std::vector<Source> m_Sources;
+
+	unsigned int m_VAO = 0, m_VBO = 0, m_EBO = 0, m_MaterialVBO = 0;
+	MaterialTable* m_MaterialTable = nullptr;
+	std::vector<Cell> m_Cells;
+	std::vector<Range> m_Ranges;
+	std::vector<Material> m_Materials;
+
+	std::vector<bool> m_CellVisible;
+	std::vector<GLsizei> m_Counts;
+	std::vector<const void*> m_Offsets;
+	StaticBatchStats m_Stats;
+};
+#endif
@@ -0,0 +1,272 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// must match textureArrays[] in material_array.fs
+#define MAX_TEXTURE_ARRAYS 8
+
+// Layer of a TextureArrayPool, packed as array << 16 | layer so it fits a single int in the material buffer
+typedef int TextureArrayLayer;
+const TextureArrayLayer INVALID_TEXTURE_LAYER = -1;
+
+// Packs textures of the same size into GL_TEXTURE_2D_ARRAY layers, one array per size, all stored as RGBA8.
+// Textures are staged on the CPU by add() and uploaded together by build(); adds after a build() go to new arrays.
+// bind() makes every array available with one bind per array, instead of one per texture per mesh.
+class TextureArrayPool
+{
+public:
+	~TextureArrayPool()
+	{
+		for (const Array& array : m_Arrays)
+			glDeleteTextures(1, &array.texture);
+	}
+
+	TextureArrayPool() = default;
+	TextureArrayPool(const TextureArrayPool&) = delete;
+	TextureArrayPool& operator=(const TextureArrayPool&) = delete;
+
+	// copies a loaded GL_TEXTURE_2D (e.g. a Texture::id from the model loaders) into the pool; the same id
+	// added twice gets the same layer. INVALID_TEXTURE_LAYER for textures without storage or when the pool is full.
+	// The finest resident level is copied (GL_TEXTURE_BASE_LEVEL), so a texture of a TextureStreamer comes in at
+	// the resolution it has when added. For full detail, request() it at full size and let the streamer's
+	// update() bring in the finer levels before adding it.
+	TextureArrayLayer add(unsigned int texture)
+	{
+		const auto found = m_TextureLayers.find(texture);
+		if (found != m_TextureLayers.end())
+			return found->second;
+
+		GLint previous, baseLevel = 0, width = 0, height = 0;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		// streamed textures may have no level 0 storage, only their resident levels from the base level on
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, GL_TEXTURE_HEIGHT, &height);
+		std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+		if (!pixels.empty())
+		{
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glGetTexImage(GL_TEXTURE_2D, baseLevel, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		}
+		glBindTexture(GL_TEXTURE_2D, previous);
+
+		const TextureArrayLayer layer = pixels.empty() ? INVALID_TEXTURE_LAYER : add(width, height, std::move(pixels));
+		m_TextureLayers[texture] = layer;
+		return layer;
+	}
+
+	// tightly packed RGBA8 pixels
+	TextureArrayLayer add(int width, int height, std::vector<unsigned char> pixels)
+	{
+		const std::pair<int, int> size(width, height);
+		auto bucket = m_Pending.find(size);
+		if (bucket == m_Pending.end())
+		{
+			GLint maxLayers;
+			glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+			if (m_Arrays.size() >= MAX_TEXTURE_ARRAYS || width <= 0 || height <= 0)
+				return INVALID_TEXTURE_LAYER;
+			bucket = m_Pending.emplace(size, Pending{ static_cast<int>(m_Arrays.size()), std::min(maxLayers, 0xFFFF), {} }).first;
+			m_Arrays.push_back({ 0, width, height, 0 });
+		}
+
+		Pending& pending = bucket->second;
+		const int arrayIndex = pending.array;
+		const int layer = m_Arrays[arrayIndex].layers++;
+		pending.layers.push_back(std::move(pixels));
+		// full array: the next texture of this size starts a new one
+		if (m_Arrays[arrayIndex].layers == pending.maxLayers)
+			flushPending(bucket);
+		return arrayIndex << 16 | layer;
+	}
+
+	// uploads every staged texture and generates the mip chains
+	void build()
+	{
+		while (!m_Pending.empty())
+			flushPending(m_Pending.begin());
+	}
+
+	// binds array i to unit firstUnit + i and points textureArrays[i] at it
+	void bind(Shader& shader, unsigned int firstUnit = 0) const
+	{
+		for (size_t i = 0; i < m_Arrays.size(); i++)
+		{
+			glActiveTexture(GL_TEXTURE0 + firstUnit + static_cast<unsigned int>(i));
+			glBindTexture(GL_TEXTURE_2D_ARRAY, m_Arrays[i].texture);
+			shader.setInt("textureArrays[" + std::to_string(i) + "]", firstUnit + static_cast<int>(i));
+		}
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	size_t getArrayCount() const { return m_Arrays.size(); }
+	unsigned int getArrayTexture(size_t i) const { return m_Arrays[i].texture; }
+
+	static int arrayOf(TextureArrayLayer layer) { return layer >> 16; }
+	static int layerOf(TextureArrayLayer layer) { return layer & 0xFFFF; }
+
+private:
+	struct Array
+	{
+		unsigned int texture;
+		int width;
+		int height;
+		int layers;
+	};
+
+	struct Pending
+	{
+		int array;
+		int maxLayers;
+		std::vector<std::vector<unsigned char>> layers;
+	};
+
+	void flushPending(std::map<std::pair<int, int>, Pending>::iterator bucket)
+	{
+		Pending& pending = bucket->second;
+		Array& array = m_Arrays[pending.array];
+
+		GLint previous;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previous);
+		glGenTextures(1, &array.texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array.width, array.height, array.layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int layer = 0; layer < array.layers; layer++)
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, array.width, array.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pending.layers[layer].data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		// same sampling as TextureFromFile
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, previous);
+
+		m_Pending.erase(bucket);
+	}
+
+	std::vector<Array> m_Arrays;
+	std::map<std::pair<int, int>, Pending> m_Pending;
+	std::unordered_map<unsigned int, TextureArrayLayer> m_TextureLayers;
+};
+
+// One layer per texture slot, INVALID_TEXTURE_LAYER where the mesh has none
+struct GpuMaterial
+{
+	TextureArrayLayer diffuse = INVALID_TEXTURE_LAYER;
+	TextureArrayLayer specular = INVALID_TEXTURE_LAYER;
+	TextureArrayLayer normal = INVALID_TEXTURE_LAYER;
+	TextureArrayLayer height = INVALID_TEXTURE_LAYER;
+};
+
+// Materials of the pool's textures in a buffer texture (one RGBA32I texel per material, GL 3.1 core), so shaders
+// look them up by an index that comes per draw, instance or vertex instead of binding textures per mesh.
+class MaterialTable
+{
+public:
+	explicit MaterialTable(TextureArrayPool& pool) : m_Pool(&pool) {}
+
+	~MaterialTable()
+	{
+		if (m_Buffer)
+		{
+			glDeleteTextures(1, &m_BufferTexture);
+			glDeleteBuffers(1, &m_Buffer);
+		}
+	}
+
+	MaterialTable(const MaterialTable&) = delete;
+	MaterialTable& operator=(const MaterialTable&) = delete;
+
+	// material index of a mesh's texture set; meshes sharing a texture set share the material
+	unsigned int add(const std::vector<Texture>& textures)
+	{
+		std::vector<unsigned int> key;
+		for (const Texture& texture : textures)
+			key.push_back(texture.id);
+		const auto found = m_Lookup.find(key);
+		if (found != m_Lookup.end())
+			return found->second;
+
+		// first texture of each type, as texture_diffuse1 etc. in Mesh::BindTextures
+		GpuMaterial material;
+		for (const Texture& texture : textures)
+		{
+			TextureArrayLayer* slot = nullptr;
+			if (texture.type == "texture_diffuse")
+				slot = &material.diffuse;
+			else if (texture.type == "texture_specular")
+				slot = &material.specular;
+			else if (texture.type == "texture_normal")
+				slot = &material.normal;
+			else if (texture.type == "texture_height")
+				slot = &material.height;
+			if (slot && *slot == INVALID_TEXTURE_LAYER)
+				*slot = m_Pool->add(texture.id);
+		}
+
+		const unsigned int index = static_cast<unsigned int>(m_Materials.size());
+		m_Materials.push_back(material);
+		m_Lookup.emplace(std::move(key), index);
+		m_Dirty = true;
+		return index;
+	}
+
+	const GpuMaterial& get(unsigned int index) const { return m_Materials[index]; }
+	size_t size() const { return m_Materials.size(); }
+
+	// builds the pool and re-uploads the material buffer when materials were added
+	void upload()
+	{
+		m_Pool->build();
+		if (!m_Dirty)
+			return;
+		m_Dirty = false;
+
+		if (!m_Buffer)
+		{
+			glGenBuffers(1, &m_Buffer);
+			glGenTextures(1, &m_BufferTexture);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, m_Buffer);
+		glBufferData(GL_TEXTURE_BUFFER, m_Materials.size() * sizeof(GpuMaterial), m_Materials.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		glBindTexture(GL_TEXTURE_BUFFER, m_BufferTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, m_Buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+	}
+
+	// the pool's arrays on units 0..n-1 and the material buffer on the unit after them
+	void bind(Shader& shader) const
+	{
+		m_Pool->bind(shader, 0);
+		const unsigned int unit = static_cast<unsigned int>(m_Pool->getArrayCount());
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_BUFFER, m_BufferTexture);
+		shader.setInt("materials", static_cast<int>(unit));
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+private:
+	TextureArrayPool* m_Pool;
+	std::vector<GpuMaterial> m_Materials;
+	std::map<std::vector<unsigned int>, unsigned int> m_Lookup;
+	unsigned int m_Buffer = 0, m_BufferTexture = 0;
+	bool m_Dirty = false;
+};
+#endif
@@ -0,0 +1,441 @@
+#ifndef TEXTURE_COOK_H
+#define TEXTURE_COOK_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/dxt_encoder.h>
+#include <learnopengl/thread_pool.h>
+
+extern "C" {
+#include <image_DXT.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// S3TC is an extension (EXT_texture_compression_s3tc) that glad wasn't generated with
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// written into DDS_header::dwReserved1 so caches from an older cooker are rebuilt
+#define TEXTURE_COOK_MAGIC (('L' << 0) | ('O' << 8) | ('G' << 16) | ('L' << 24))
+#define TEXTURE_COOK_VERSION 2
+
+enum TextureCookKind
+{
+	// sRGB-encoded colour, mips filtered in linear light; DXT1, or DXT5 when any texel isn't opaque
+	TEXTURE_COOK_COLOR,
+	// tangent-space normal map, mips renormalised; BC5 keeps x and y, shaders rebuild z = sqrt(1 - x*x - y*y)
+	TEXTURE_COOK_NORMAL
+};
+
+struct TextureMip
+{
+	int width;
+	int height;
+	std::vector<unsigned char> rgba;
+};
+
+// block-compressed mip chain, levels stored back to back in data
+struct CookedTexture
+{
+	GLenum format = 0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT or GL_COMPRESSED_RG_RGTC2
+	struct Level
+	{
+		int width;
+		int height;
+		size_t offset;
+		size_t size;
+	};
+	std::vector<Level> levels;
+	std::vector<unsigned char> data;
+};
+
+// bytes per 4x4 block of a cooked format
+inline size_t CookedBlockSize(GLenum format)
+{
+	return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+}
+
+inline size_t CookedLevelSize(GLenum format, int width, int height)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * CookedBlockSize(format);
+}
+
+namespace texture_cook_detail
+{
+	inline float srgbToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	inline float linearToSrgb(float c)
+	{
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// halves one axis with the [1 3 3 1] / 8 kernel (bilinear-tent downsample), clamping at the edges
+	inline void downsampleRows(const std::vector<float>& src, int width, int height, std::vector<float>& dst, int dstWidth)
+	{
+		static const float weights[4] = { 0.125f, 0.375f, 0.375f, 0.125f };
+		dst.assign(static_cast<size_t>(dstWidth) * height * 4, 0.0f);
+		for (int y = 0; y < height; y++)
+		{
+			const float* row = &src[static_cast<size_t>(y) * width * 4];
+			float* out = &dst[static_cast<size_t>(y) * dstWidth * 4];
+			for (int x = 0; x < dstWidth; x++)
+			{
+				for (int tap = 0; tap < 4; tap++)
+				{
+					const int sx = std::min(std::max(2 * x - 1 + tap, 0), width - 1);
+					for (int c = 0; c < 4; c++)
+						out[x * 4 + c] += row[sx * 4 + c] * weights[tap];
+				}
+			}
+		}
+	}
+
+	inline void transpose(const std::vector<float>& src, int width, int height, std::vector<float>& dst)
+	{
+		dst.resize(src.size());
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++)
+				std::memcpy(&dst[(static_cast<size_t>(x) * height + y) * 4], &src[(static_cast<size_t>(y) * width + x) * 4], 4 * sizeof(float));
+	}
+
+	inline bool hasExtension(const char* name)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (extension && std::strcmp(extension, name) == 0)
+				return true;
+		}
+		return false;
+	}
+}
+
+// Full mip chain down to 1x1 from tightly packed RGBA8, filtered in float so no level is built from a quantised one
+inline std::vector<TextureMip> BuildTextureMips(const unsigned char* rgba, int width, int height, TextureCookKind kind)
+{
+	using namespace texture_cook_detail;
+
+	std::vector<float> level(static_cast<size_t>(width) * height * 4);
+	for (size_t i = 0; i < level.size(); i += 4)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			const float value = rgba[i + c] / 255.0f;
+			level[i + c] = kind == TEXTURE_COOK_NORMAL ? value * 2.0f - 1.0f : srgbToLinear(value);
+		}
+		level[i + 3] = rgba[i + 3] / 255.0f;
+	}
+
+	std::vector<TextureMip> mips;
+	std::vector<float> rows, transposed;
+	while (true)
+	{
+		TextureMip mip{ width, height, std::vector<unsigned char>(level.size()) };
+		for (size_t i = 0; i < level.size(); i += 4)
+		{
+			float texel[4] = { level[i], level[i + 1], level[i + 2], level[i + 3] };
+			if (kind == TEXTURE_COOK_NORMAL)
+			{
+				const float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+				for (int c = 0; c < 3; c++)
+					texel[c] = (length > 0.0f ? texel[c] / length : (c == 2 ? 1.0f : 0.0f)) * 0.5f + 0.5f;
+			}
+			else
+			{
+				for (int c = 0; c < 3; c++)
+					texel[c] = linearToSrgb(texel[c]);
+			}
+			for (int c = 0; c < 4; c++)
+				mip.rgba[i + c] = static_cast<unsigned char>(std::lround(std::min(std::max(texel[c], 0.0f), 1.0f) * 255.0f));
+		}
+		mips.push_back(std::move(mip));
+		if (width == 1 && height == 1)
+			break;
+
+		// x then y, through a transpose so both passes run along rows
+		const int nextWidth = std::max(1, width / 2);
+		const int nextHeight = std::max(1, height / 2);
+		downsampleRows(level, width, height, rows, nextWidth);
+		transpose(rows, nextWidth, height, transposed);
+		downsampleRows(transposed, height, nextWidth, rows, nextHeight);
+		transpose(rows, nextHeight, nextWidth, level);
+		width = nextWidth;
+		height = nextHeight;
+	}
+	return mips;
+}
+
+// DXT1/DXT5 for colour, BC5 for normal maps, every level through EncodeDXT on pool
+inline CookedTexture CompressTextureMips(const std::vector<TextureMip>& mips, TextureCookKind kind, ThreadPool& pool = ThreadPool::global(), DXTEncodeStats* stats = nullptr)
+{
+	CookedTexture cooked;
+	DXTFormat format = DXT_FORMAT_BC5;
+	cooked.format = GL_COMPRESSED_RG_RGTC2;
+	if (kind == TEXTURE_COOK_COLOR)
+	{
+		const std::vector<unsigned char>& base = mips[0].rgba;
+		bool opaque = true;
+		for (size_t i = 3; i < base.size() && opaque; i += 4)
+			opaque = base[i] == 255;
+		format = opaque ? DXT_FORMAT_DXT1 : DXT_FORMAT_DXT5;
+		cooked.format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+
+	for (const TextureMip& mip : mips)
+	{
+		const std::vector<unsigned char> blocks = EncodeDXT(mip.rgba.data(), mip.width, mip.height, format, pool, stats);
+		cooked.levels.push_back({ mip.width, mip.height, cooked.data.size(), blocks.size() });
+		cooked.data.insert(cooked.data.end(), blocks.begin(), blocks.end());
+	}
+	return cooked;
+}
+
+// DDS with the whole mip chain: FourCC DXT1, DXT5 or ATI2 (BC5)
+inline bool WriteCookedTexture(const std::string& path, const CookedTexture& cooked)
+{
+	if (cooked.levels.empty())
+		return false;
+
+	DDS_header header;
+	std::memset(&header, 0, sizeof(header));
+	header.dwMagic = ('D' << 0) | ('D' << 8) | ('S' << 16) | (' ' << 24);
+	header.dwSize = 124;
+	header.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.dwWidth = cooked.levels[0].width;
+	header.dwHeight = cooked.levels[0].height;
+	header.dwPitchOrLinearSize = static_cast<unsigned int>(cooked.levels[0].size);
+	header.dwMipMapCount = static_cast<unsigned int>(cooked.levels.size());
+	header.dwReserved1[0] = TEXTURE_COOK_MAGIC;
+	header.dwReserved1[1] = TEXTURE_COOK_VERSION;
+	header.sPixelFormat.dwSize = 32;
+	header.sPixelFormat.dwFlags = DDPF_FOURCC;
+	if (cooked.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+		header.sPixelFormat.dwFourCC = ('D' << 0) | ('X' << 8) | ('T' << 16) | ('1' << 24);
+	else if (cooked.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+		header.sPixelFormat.dwFourCC = ('D' << 0) | ('X' << 8) | ('T' << 16) | ('5' << 24);
+	else
+		header.sPixelFormat.dwFourCC = ('A' << 0) | ('T' << 8) | ('I' << 16) | ('2' << 24);
+	header.sCaps.dwCaps1 = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(cooked.data.data()), cooked.data.size());
+	return static_cast<bool>(file);
+}
+
+// level offsets are relative to this, the DDS header comes first
+inline size_t CookedTextureDataOffset()
+{
+	return sizeof(DDS_header);
+}
+
+// format and level layout of a file written by WriteCookedTexture (same magic and version), data is left empty
+inline bool ReadCookedTextureHeader(std::istream& file, CookedTexture& cooked)
+{
+	file.seekg(0, std::ios::end);
+	const std::streamoff fileSize = file.tellg();
+	DDS_header header;
+	if (fileSize < static_cast<std::streamoff>(sizeof(header)))
+		return false;
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.dwMagic != (('D' << 0) | ('D' << 8) | ('S' << 16) | (' ' << 24)) ||
+		header.dwReserved1[0] != TEXTURE_COOK_MAGIC || header.dwReserved1[1] != TEXTURE_COOK_VERSION)
+		return false;
+
+	const unsigned int fourCC = header.sPixelFormat.dwFourCC;
+	if (fourCC == (('D' << 0) | ('X' << 8) | ('T' << 16) | ('1' << 24)))
+		cooked.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	else if (fourCC == (('D' << 0) | ('X' << 8) | ('T' << 16) | ('5' << 24)))
+		cooked.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	else if (fourCC == (('A' << 0) | ('T' << 8) | ('I' << 16) | ('2' << 24)))
+		cooked.format = GL_COMPRESSED_RG_RGTC2;
+	else
+		return false;
+
+	cooked.levels.clear();
+	size_t offset = 0;
+	int width = static_cast<int>(header.dwWidth), height = static_cast<int>(header.dwHeight);
+	for (unsigned int i = 0; i < std::max(1u, header.dwMipMapCount); i++)
+	{
+		const size_t size = CookedLevelSize(cooked.format, width, height);
+		cooked.levels.push_back({ width, height, offset, size });
+		offset += size;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	cooked.data.clear();
+	return static_cast<std::streamoff>(sizeof(header) + offset) <= fileSize;
+}
+
+// only reads files written by WriteCookedTexture (same magic and version)
+inline bool ReadCookedTexture(const std::string& path, CookedTexture& cooked)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file || !ReadCookedTextureHeader(file, cooked))
+		return false;
+	const CookedTexture::Level& last = cooked.levels.back();
+	cooked.data.resize(last.offset + last.size);
+	file.seekg(static_cast<std::streamoff>(CookedTextureDataOffset()));
+	file.read(reinterpret_cast<char*>(cooked.data.data()), cooked.data.size());
+	return static_cast<bool>(file);
+}
+
+// S3TC is near universal on desktop but still an extension; RGTC is core since GL 3.0
+inline bool IsCookedFormatSupported(GLenum format)
+{
+	if (format == GL_COMPRESSED_RG_RGTC2)
+		return true;
+	static const bool s3tc = texture_cook_detail::hasExtension("GL_EXT_texture_compression_s3tc");
+	return s3tc;
+}
+
+// 0 when the format isn't supported
+inline unsigned int UploadCookedTexture(const CookedTexture& cooked)
+{
+	if (cooked.levels.empty() || !IsCookedFormatSupported(cooked.format))
+		return 0;
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	for (size_t i = 0; i < cooked.levels.size(); i++)
+	{
+		const CookedTexture::Level& level = cooked.levels[i];
+		glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), cooked.format, level.width, level.height, 0,
+			static_cast<GLsizei>(level.size), cooked.data.data() + level.offset);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(cooked.levels.size()) - 1);
+	// same sampling as TextureFromFile
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return textureID;
+}
+
+// cache next to the source image, one per kind in case an image is used both ways
+inline std::string CookedTexturePath(const std::string& filename, TextureCookKind kind)
+{
+	return filename + (kind == TEXTURE_COOK_NORMAL ? ".normal.dds" : ".cooked.dds");
+}
+
+// decodes, builds mips, compresses and writes the cache; false when the image can't be loaded
+inline bool CookTexture(const std::string& filename, TextureCookKind kind, CookedTexture& cooked, ThreadPool& pool = ThreadPool::global())
+{
+	int width, height, nrComponents;
+	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 4);
+	if (!data)
+		return false;
+	cooked = CompressTextureMips(BuildTextureMips(data, width, height, kind), kind, pool);
+	stbi_image_free(data);
+	if (cooked.levels.empty())
+		return false;
+	if (!WriteCookedTexture(CookedTexturePath(filename, kind), cooked))
+		std::cout << "Texture cache could not be written: " << CookedTexturePath(filename, kind) << std::endl;
+	return true;
+}
+
+// the cache exists and isn't older than the image (a cache without its image counts as fresh)
+inline bool IsCookedTextureFresh(const std::string& filename, TextureCookKind kind)
+{
+	const std::string cachePath = CookedTexturePath(filename, kind);
+	std::error_code error;
+	const bool hasSource = std::filesystem::exists(filename, error);
+	return std::filesystem::exists(cachePath, error) &&
+		(!hasSource || std::filesystem::last_write_time(cachePath, error) >= std::filesystem::last_write_time(filename, error));
+}
+
+// Like TextureFromFile, but through the cooked cache: an up-to-date cache is uploaded as is with
+// glCompressedTexImage2D, without decoding the image; otherwise the image is cooked first.
+// Returns 0 when the image can't be loaded or the GPU lacks the format, so callers can fall back.
+inline unsigned int CookedTextureFromFile(const char* path, const std::string& directory, TextureCookKind kind)
+{
+	const std::string filename = directory + '/' + std::string(path);
+
+	CookedTexture cooked;
+	if (!(IsCookedTextureFresh(filename, kind) && ReadCookedTexture(CookedTexturePath(filename, kind), cooked)))
+	{
+		if (!CookTexture(filename, kind, cooked))
+			return 0;
+	}
+	return UploadCookedTexture(cooked);
+}
+struct TextureEncoderBenchmark
+{
+	std::string name;
+	int width = 0;
+	int height = 0;
+	DXTFormat format = DXT_FORMAT_DXT1;
+	double referenceMegapixelsPerSecond = 0.0; // image_DXT's single-threaded encoder
+	double referencePSNR = 0.0;
+	double megapixelsPerSecond = 0.0;          // EncodeDXT
+	double psnr = 0.0;
+
+	void print(std::ostream& out) const
+	{
+		static const char* formats[] = { "DXT1", "DXT5", "BC5" };
+		out << name << " " << width << "x" << height << " " << formats[format] << ": image_DXT " << referenceMegapixelsPerSecond
+			<< " MP/s " << referencePSNR << " dB, EncodeDXT " << megapixelsPerSecond << " MP/s " << psnr << " dB" << std::endl;
+	}
+};
+
+// Level 0 of an image encoded by both encoders, as the cooker would pick the format (BC5 for normal maps, which
+// image_DXT can't write, so its reference numbers stay 0 there)
+inline TextureEncoderBenchmark BenchmarkTextureEncoder(const std::string& filename, TextureCookKind kind, ThreadPool& pool = ThreadPool::global())
+{
+	TextureEncoderBenchmark result;
+	result.name = filename;
+	int nrComponents;
+	unsigned char* data = stbi_load(filename.c_str(), &result.width, &result.height, &nrComponents, 4);
+	if (!data)
+		return result;
+
+	result.format = DXT_FORMAT_BC5;
+	if (kind == TEXTURE_COOK_COLOR)
+	{
+		bool opaque = true;
+		for (size_t i = 3; i < static_cast<size_t>(result.width) * result.height * 4 && opaque; i += 4)
+			opaque = data[i] == 255;
+		result.format = opaque ? DXT_FORMAT_DXT1 : DXT_FORMAT_DXT5;
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		int size = 0;
+		unsigned char* reference = opaque ? convert_image_to_DXT1(data, result.width, result.height, 4, &size)
+			: convert_image_to_DXT5(data, result.width, result.height, 4, &size);
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		result.referenceMegapixelsPerSecond = static_cast<double>(result.width) * result.height / (milliseconds * 1000.0);
+		result.referencePSNR = DXTPeakSignalToNoise(data, DecodeDXT(reference, result.width, result.height, result.format).data(), result.width, result.height, result.format);
+		free(reference);
+	}
+
+	DXTEncodeStats stats;
+	const std::vector<unsigned char> blocks = EncodeDXT(data, result.width, result.height, result.format, pool, &stats);
+	result.megapixelsPerSecond = stats.megapixelsPerSecond();
+	result.psnr = DXTPeakSignalToNoise(data, DecodeDXT(blocks.data(), result.width, result.height, result.format).data(), result.width, result.height, result.format);
+	stbi_image_free(data);
+	return result;
+}
+#endif
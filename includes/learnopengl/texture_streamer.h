@@ -0,0 +1,375 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/texture_cook.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Mip residency of one streamed texture; levels are GL mip levels, 0 is the finest
+struct TextureResidency
+{
+	std::string path;
+	int width = 0;           // level 0
+	int height = 0;
+	int levels = 0;
+	int residentLevel = 0;   // finest level in VRAM, the texture's GL_TEXTURE_BASE_LEVEL
+	int tailLevel = 0;       // this level and the coarser ones stay resident
+	int wantedLevel = 0;     // finest level asked for by the last frame that needed the texture
+	int loadingLevel = -1;   // finest level of the read in flight, -1 when there is none
+	size_t residentBytes = 0;
+	size_t totalBytes = 0;   // the whole chain
+	uint64_t lastNeededFrame = 0;
+};
+
+struct TextureStreamingStats
+{
+	size_t textures = 0;
+	size_t budgetBytes = 0;
+	size_t residentBytes = 0;
+	size_t totalBytes = 0;   // what every texture would take fully resident
+	size_t loadingBytes = 0; // reads in flight, already counted against the budget
+	unsigned int loadsInFlight = 0;
+	// last update()
+	unsigned int levelsUploaded = 0;
+	unsigned int levelsEvicted = 0;
+	size_t bytesUploaded = 0;
+	unsigned int loadsDeferred = 0; // wanted levels that didn't fit the budget
+};
+
+// Streams the mip levels of cooked textures (see texture_cook.h) under a VRAM budget. load() uploads only the
+// mip tail; finer levels follow the screen-size feedback given to request() (RenderQueue does this for every
+// mesh it draws), are read from the cache file on the pool and uploaded by update() on the GL thread.
+// Levels that are no longer needed stay cached until the budget runs out, then the least recently needed
+// textures lose theirs first. Residency is set with GL_TEXTURE_BASE_LEVEL; evicted levels are respecified as 0x0,
+// so code that reads a streamed texture back (TextureArrayPool::add) has to start at the base level, and only
+// gets the resolution resident at that moment.
+class TextureStreamer
+{
+public:
+	// tailSize: levels at most this wide and high are uploaded by load() and never evicted
+	explicit TextureStreamer(size_t budgetBytes, ThreadPool& pool = ThreadPool::global(), int tailSize = 64)
+		: m_Pool(pool), m_TailSize(std::max(1, tailSize))
+	{
+		m_Stats.budgetBytes = budgetBytes;
+	}
+
+	~TextureStreamer()
+	{
+		for (auto& entry : m_Textures)
+		{
+			if (entry.second.load.valid())
+				entry.second.load.wait();
+			glDeleteTextures(1, &entry.first);
+		}
+	}
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// same arguments as CookedTextureFromFile, cooks the image when its cache is missing or stale.
+	// 0 when the image can't be loaded or the GPU lacks the format, so callers can fall back.
+	unsigned int load(const char* path, const std::string& directory, TextureCookKind kind)
+	{
+		const std::string filename = directory + '/' + std::string(path);
+		const std::string cachePath = CookedTexturePath(filename, kind);
+		CookedTexture cooked;
+		if (!IsCookedTextureFresh(filename, kind) && !CookTexture(filename, kind, cooked, m_Pool))
+			return 0;
+
+		// the finer levels are read back from the cache later, so it has to be usable
+		CookedTexture layout;
+		std::ifstream file(cachePath, std::ios::binary);
+		if (!file || !ReadCookedTextureHeader(file, layout) || !IsCookedFormatSupported(layout.format))
+			return 0;
+
+		Streamed streamed;
+		streamed.cachePath = cachePath;
+		streamed.format = layout.format;
+		streamed.levels = layout.levels;
+		TextureResidency& residency = streamed.residency;
+		residency.path = filename;
+		residency.width = layout.levels[0].width;
+		residency.height = layout.levels[0].height;
+		residency.levels = static_cast<int>(layout.levels.size());
+		residency.tailLevel = residency.levels - 1;
+		while (residency.tailLevel > 0 && std::max(layout.levels[residency.tailLevel - 1].width, layout.levels[residency.tailLevel - 1].height) <= m_TailSize)
+			residency.tailLevel--;
+		residency.residentLevel = residency.tailLevel;
+		residency.wantedLevel = residency.tailLevel;
+		for (const CookedTexture::Level& level : layout.levels)
+			residency.totalBytes += level.size;
+
+		const size_t tailOffset = layout.levels[residency.tailLevel].offset;
+		std::vector<unsigned char> tail = readLevels(cachePath, tailOffset, residency.totalBytes - tailOffset);
+		if (tail.empty())
+			return 0;
+
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		residency.residentBytes = uploadLevels(streamed, residency.tailLevel, residency.levels, tail.data(), tailOffset);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, residency.tailLevel);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, residency.levels - 1);
+		// same sampling as TextureFromFile
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		m_Stats.textures++;
+		m_Stats.residentBytes += residency.residentBytes;
+		m_Stats.totalBytes += residency.totalBytes;
+		m_Textures.emplace(textureID, std::move(streamed));
+		return textureID;
+	}
+
+	// Feedback for this frame: the texture covers about screenPixels pixels across (e.g. the projected diameter
+	// of the mesh using it), so levels finer than that are not needed. Textures this streamer didn't load are ignored.
+	void request(unsigned int texture, float screenPixels)
+	{
+		auto found = m_Textures.find(texture);
+		if (found == m_Textures.end())
+			return;
+		TextureResidency& residency = found->second.residency;
+		const float size = static_cast<float>(std::max(residency.width, residency.height));
+		const int level = screenPixels >= size ? 0
+			: screenPixels <= 1.0f ? residency.levels - 1
+			: std::min(residency.levels - 1, static_cast<int>(std::floor(std::log2(size / screenPixels))));
+		if (residency.lastNeededFrame != m_Frame)
+		{
+			residency.lastNeededFrame = m_Frame;
+			residency.wantedLevel = level;
+		}
+		else
+			residency.wantedLevel = std::min(residency.wantedLevel, level);
+	}
+
+	// once per frame on the GL thread, after the frame's request() calls: uploads finished reads,
+	// starts reads for levels that were asked for and evicts to make room for them
+	void update()
+	{
+		m_Stats.levelsUploaded = 0;
+		m_Stats.levelsEvicted = 0;
+		m_Stats.bytesUploaded = 0;
+		m_Stats.loadsDeferred = 0;
+		GLint previous;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+
+		uploadFinishedLoads();
+		startLoads();
+
+		glBindTexture(GL_TEXTURE_2D, previous);
+		m_Frame++;
+	}
+
+	// takes effect on the next update(); a lower budget evicts whatever isn't needed right away
+	void setBudget(size_t budgetBytes) { m_Stats.budgetBytes = budgetBytes; }
+	size_t getBudget() const { return m_Stats.budgetBytes; }
+
+	// finished reads beyond this many bytes wait for the next update(), at least one is uploaded per frame
+	void setMaxUploadBytesPerFrame(size_t bytes) { m_MaxUploadBytes = bytes; }
+
+	bool isStreamed(unsigned int texture) const { return m_Textures.count(texture) != 0; }
+
+	// nullptr for textures this streamer didn't load
+	const TextureResidency* getResidency(unsigned int texture) const
+	{
+		auto found = m_Textures.find(texture);
+		return found == m_Textures.end() ? nullptr : &found->second.residency;
+	}
+
+	std::vector<TextureResidency> getResidencies() const
+	{
+		std::vector<TextureResidency> residencies;
+		for (const auto& entry : m_Textures)
+			residencies.push_back(entry.second.residency);
+		return residencies;
+	}
+
+	const TextureStreamingStats& getStats() const { return m_Stats; }
+
+private:
+	struct Streamed
+	{
+		TextureResidency residency;
+		std::string cachePath;
+		GLenum format = 0;
+		std::vector<CookedTexture::Level> levels;
+		std::future<std::vector<unsigned char>> load; // levels loadingLevel..residentLevel-1
+		size_t loadBytes = 0;
+	};
+
+	// bytes [offset, offset + size) of the level data; empty when the file can't be read
+	static std::vector<unsigned char> readLevels(const std::string& cachePath, size_t offset, size_t size)
+	{
+		std::vector<unsigned char> data(size);
+		std::ifstream file(cachePath, std::ios::binary);
+		file.seekg(static_cast<std::streamoff>(CookedTextureDataOffset() + offset));
+		file.read(reinterpret_cast<char*>(data.data()), size);
+		if (!file)
+			data.clear();
+		return data;
+	}
+
+	// levels [first, end) of the bound texture from data, which starts at the level data offset dataOffset
+	static size_t uploadLevels(const Streamed& streamed, int first, int end, const unsigned char* data, size_t dataOffset)
+	{
+		size_t bytes = 0;
+		for (int i = first; i < end; i++)
+		{
+			const CookedTexture::Level& level = streamed.levels[i];
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, streamed.format, level.width, level.height, 0,
+				static_cast<GLsizei>(level.size), data + (level.offset - dataOffset));
+			bytes += level.size;
+		}
+		return bytes;
+	}
+
+	void uploadFinishedLoads()
+	{
+		for (auto& entry : m_Textures)
+		{
+			Streamed& streamed = entry.second;
+			if (!streamed.load.valid() || streamed.load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
+			if (m_Stats.levelsUploaded > 0 && m_Stats.bytesUploaded + streamed.loadBytes > m_MaxUploadBytes)
+				continue;
+
+			TextureResidency& residency = streamed.residency;
+			const std::vector<unsigned char> data = streamed.load.get();
+			m_Stats.loadingBytes -= streamed.loadBytes;
+			m_Stats.loadsInFlight--;
+			if (!data.empty())
+			{
+				glBindTexture(GL_TEXTURE_2D, entry.first);
+				const size_t bytes = uploadLevels(streamed, residency.loadingLevel, residency.residentLevel, data.data(), streamed.levels[residency.loadingLevel].offset);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, residency.loadingLevel);
+				m_Stats.levelsUploaded += residency.residentLevel - residency.loadingLevel;
+				m_Stats.bytesUploaded += bytes;
+				m_Stats.residentBytes += bytes;
+				residency.residentBytes += bytes;
+				residency.residentLevel = residency.loadingLevel;
+			}
+			residency.loadingLevel = -1;
+			streamed.loadBytes = 0;
+		}
+	}
+
+	void startLoads()
+	{
+		// textures this frame asked for finer levels, the most under-resolved first
+		std::vector<std::pair<unsigned int, Streamed*>> wanted;
+		for (auto& entry : m_Textures)
+		{
+			const TextureResidency& residency = entry.second.residency;
+			if (residency.lastNeededFrame == m_Frame && residency.wantedLevel < residency.residentLevel && residency.loadingLevel < 0)
+				wanted.push_back({ entry.first, &entry.second });
+		}
+		std::sort(wanted.begin(), wanted.end(), [](const std::pair<unsigned int, Streamed*>& a, const std::pair<unsigned int, Streamed*>& b)
+		{
+			const TextureResidency& ra = a.second->residency;
+			const TextureResidency& rb = b.second->residency;
+			return ra.residentLevel - ra.wantedLevel > rb.residentLevel - rb.wantedLevel;
+		});
+
+		// over budget without new loads, e.g. after setBudget()
+		if (committedBytes() > m_Stats.budgetBytes)
+			evict(committedBytes() - m_Stats.budgetBytes);
+
+		for (const auto& entry : wanted)
+		{
+			Streamed& streamed = *entry.second;
+			TextureResidency& residency = streamed.residency;
+			const size_t end = streamed.levels[residency.residentLevel].offset;
+			size_t bytes = end - streamed.levels[residency.wantedLevel].offset;
+			if (committedBytes() + bytes > m_Stats.budgetBytes)
+				evict(committedBytes() + bytes - m_Stats.budgetBytes);
+
+			// whatever part of the wanted range fits, coarsest levels first
+			int first = residency.wantedLevel;
+			while (first < residency.residentLevel && committedBytes() + bytes > m_Stats.budgetBytes)
+			{
+				bytes -= streamed.levels[first].size;
+				first++;
+			}
+			if (first != residency.wantedLevel)
+				m_Stats.loadsDeferred++;
+			if (first == residency.residentLevel)
+				continue;
+
+			const size_t offset = streamed.levels[first].offset;
+			const std::string cachePath = streamed.cachePath;
+			residency.loadingLevel = first;
+			streamed.loadBytes = bytes;
+			streamed.load = m_Pool.submit([cachePath, offset, bytes] { return readLevels(cachePath, offset, bytes); });
+			m_Stats.loadingBytes += bytes;
+			m_Stats.loadsInFlight++;
+		}
+	}
+
+	size_t committedBytes() const { return m_Stats.residentBytes + m_Stats.loadingBytes; }
+
+	// Drops levels until bytes are freed or nothing more can go: levels finer than a texture's wanted level when
+	// this frame needed it, everything above the tail otherwise, least recently needed textures first.
+	// Textures with a read in flight keep their levels so the chain stays contiguous.
+	void evict(size_t bytes)
+	{
+		std::vector<std::pair<unsigned int, Streamed*>> candidates;
+		for (auto& entry : m_Textures)
+		{
+			const TextureResidency& residency = entry.second.residency;
+			if (residency.loadingLevel < 0 && residency.residentLevel < evictLimit(residency))
+				candidates.push_back({ entry.first, &entry.second });
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const std::pair<unsigned int, Streamed*>& a, const std::pair<unsigned int, Streamed*>& b)
+		{
+			return a.second->residency.lastNeededFrame < b.second->residency.lastNeededFrame;
+		});
+
+		size_t freed = 0;
+		for (const auto& entry : candidates)
+		{
+			if (freed >= bytes)
+				break;
+			Streamed& streamed = *entry.second;
+			TextureResidency& residency = streamed.residency;
+			glBindTexture(GL_TEXTURE_2D, entry.first);
+			const int limit = evictLimit(residency);
+			while (residency.residentLevel < limit && freed < bytes)
+			{
+				const int level = residency.residentLevel++;
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, residency.residentLevel);
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, streamed.format, 0, 0, 0, 0, nullptr);
+				const size_t size = streamed.levels[level].size;
+				residency.residentBytes -= size;
+				m_Stats.residentBytes -= size;
+				m_Stats.levelsEvicted++;
+				freed += size;
+			}
+		}
+	}
+
+	int evictLimit(const TextureResidency& residency) const
+	{
+		return residency.lastNeededFrame == m_Frame ? std::min(residency.wantedLevel, residency.tailLevel) : residency.tailLevel;
+	}
+
+	ThreadPool& m_Pool;
+	int m_TailSize;
+	size_t m_MaxUploadBytes = 16 * 1024 * 1024;
+	uint64_t m_Frame = 1; // 0 is "never needed"
+	std::unordered_map<unsigned int, Streamed> m_Textures;
+	TextureStreamingStats m_Stats;
+};
+#endif
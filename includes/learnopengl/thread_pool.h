@@ -0,0 +1,151 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A small fixed-size pool of worker threads. Used by the CPU-side systems (skinning, culling, import)
+// to spread independent work across cores.
+class ThreadPool
+{
+public:
+	// numThreads == 0 picks one worker per hardware thread, minus the calling thread
+	explicit ThreadPool(unsigned int numThreads = 0)
+	{
+		if (numThreads == 0)
+		{
+			// hardware_concurrency() may report 0 when it can't tell
+			const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+			numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		for (unsigned int i = 0; i < numThreads; i++)
+			m_Workers.emplace_back([this] { workerLoop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stopping = true;
+		}
+		m_Condition.notify_all();
+		for (auto& worker : m_Workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// shared pool for systems that don't own one
+	static ThreadPool& global()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+	unsigned int size() const { return static_cast<unsigned int>(m_Workers.size()); }
+
+	// queues a task and returns a future for its result
+	template<typename F>
+	auto submit(F&& task) -> std::future<decltype(task())>
+	{
+		using Result = decltype(task());
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> result = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Tasks.emplace([packaged] { (*packaged)(); });
+		}
+		m_Condition.notify_one();
+		return result;
+	}
+
+	// splits [0, count) into chunks of at least grainSize elements and calls fn(begin, end) for each.
+	// The calling thread works on chunks too and only waits for chunks that were already claimed,
+	// so it is safe to call from inside a pool task.
+	void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& fn)
+	{
+		if (count == 0)
+			return;
+
+		grainSize = std::max<size_t>(1, grainSize);
+		const size_t numChunks = (count + grainSize - 1) / grainSize;
+		if (numChunks == 1 || m_Workers.empty())
+		{
+			fn(0, count);
+			return;
+		}
+
+		struct ForState
+		{
+			std::atomic<size_t> nextChunk{ 0 };
+			std::atomic<size_t> doneChunks{ 0 };
+			std::mutex mutex;
+			std::condition_variable done;
+		};
+		auto state = std::make_shared<ForState>();
+
+		auto runChunks = [state, count, grainSize, numChunks, &fn]()
+		{
+			size_t chunk;
+			while ((chunk = state->nextChunk.fetch_add(1)) < numChunks)
+			{
+				const size_t begin = chunk * grainSize;
+				fn(begin, std::min(count, begin + grainSize));
+				if (state->doneChunks.fetch_add(1) + 1 == numChunks)
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->done.notify_all();
+				}
+			}
+		};
+
+		// helpers that start after every chunk was claimed return immediately and never touch fn
+		const size_t numHelpers = std::min<size_t>(m_Workers.size(), numChunks - 1);
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (size_t i = 0; i < numHelpers; i++)
+				m_Tasks.emplace(runChunks);
+		}
+		m_Condition.notify_all();
+
+		runChunks();
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->done.wait(lock, [&] { return state->doneChunks.load() == numChunks; });
+	}
+
+private:
+	void workerLoop()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+				if (m_Stopping && m_Tasks.empty())
+					return;
+				task = std::move(m_Tasks.front());
+				m_Tasks.pop();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> m_Workers;
+	std::queue<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_Stopping = false;
+};
+#endif
@@ -0,0 +1,155 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <learnopengl/thread_pool.h>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Flat, data-oriented alternative to the Entity/Transform scene graph.
+// Every node lives at an index in contiguous SoA arrays. A node's parent must exist when the node is created,
+// so appending keeps the arrays sorted parent-before-child and world matrices can be computed in one linear pass.
+class TransformHierarchy
+{
+public:
+	typedef uint32_t NodeId;
+	static const NodeId INVALID_NODE = 0xFFFFFFFFu;
+
+	// local space
+	std::vector<glm::vec3> localPosition;
+	std::vector<glm::quat> localRotation;
+	std::vector<glm::vec3> localScale;
+	// hierarchy
+	std::vector<NodeId> parent;
+	std::vector<uint32_t> depth;
+	// global space, valid after updateWorld()
+	std::vector<glm::mat4> world;
+
+	void reserve(size_t count)
+	{
+		localPosition.reserve(count);
+		localRotation.reserve(count);
+		localScale.reserve(count);
+		parent.reserve(count);
+		depth.reserve(count);
+		world.reserve(count);
+	}
+
+	// parentNode has to be INVALID_NODE or an existing node, which keeps parents before their children
+	NodeId create(NodeId parentNode = INVALID_NODE, const glm::vec3& position = glm::vec3(0.0f),
+		const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f))
+	{
+		assert(parentNode == INVALID_NODE || parentNode < parent.size());
+		const NodeId id = static_cast<NodeId>(parent.size());
+		localPosition.push_back(position);
+		localRotation.push_back(rotation);
+		localScale.push_back(scale);
+		parent.push_back(parentNode);
+		depth.push_back(parentNode == INVALID_NODE ? 0 : depth[parentNode] + 1);
+		world.push_back(glm::mat4(1.0f));
+		m_LevelsDirty = true;
+		return id;
+	}
+
+	size_t size() const { return parent.size(); }
+
+	void setLocalPosition(NodeId node, const glm::vec3& position) { localPosition[node] = position; }
+	void setLocalRotation(NodeId node, const glm::quat& rotation) { localRotation[node] = rotation; }
+	void setLocalScale(NodeId node, const glm::vec3& scale) { localScale[node] = scale; }
+
+	// same convention as Transform::setLocalRotation: euler angles in degrees, applied Y * X * Z
+	void setLocalEulerRotation(NodeId node, const glm::vec3& eulerDegrees)
+	{
+		localRotation[node] = eulerToQuat(eulerDegrees);
+	}
+
+	static glm::quat eulerToQuat(const glm::vec3& eulerDegrees)
+	{
+		return glm::angleAxis(glm::radians(eulerDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f)) *
+			glm::angleAxis(glm::radians(eulerDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f)) *
+			glm::angleAxis(glm::radians(eulerDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+	}
+
+	// translation * rotation * scale, built straight from the quaternion
+	glm::mat4 localMatrix(NodeId node) const
+	{
+		const glm::mat3 rotation = glm::mat3_cast(localRotation[node]);
+		const glm::vec3& scale = localScale[node];
+		return glm::mat4(
+			glm::vec4(rotation[0] * scale.x, 0.0f),
+			glm::vec4(rotation[1] * scale.y, 0.0f),
+			glm::vec4(rotation[2] * scale.z, 0.0f),
+			glm::vec4(localPosition[node], 1.0f));
+	}
+
+	// one pass over the arrays; parents always come before their children
+	void updateWorld()
+	{
+		updateRange(0, parent.size());
+	}
+
+	// level by level: all nodes of one depth only read world matrices of the previous depth,
+	// so each level is split across the pool
+	void updateWorldParallel(ThreadPool& pool = ThreadPool::global(), size_t grainSize = 2048)
+	{
+		if (m_LevelsDirty)
+			buildLevels();
+
+		for (size_t level = 0; level + 1 < m_LevelStart.size(); level++)
+		{
+			const size_t begin = m_LevelStart[level];
+			const size_t end = m_LevelStart[level + 1];
+			pool.parallelFor(end - begin, grainSize, [&](size_t first, size_t last)
+			{
+				for (size_t i = begin + first; i < begin + last; i++)
+					updateNode(m_LevelOrder[i]);
+			});
+		}
+	}
+
+private:
+	void updateRange(size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			updateNode(static_cast<NodeId>(i));
+	}
+
+	void updateNode(NodeId node)
+	{
+		const NodeId p = parent[node];
+		if (p == INVALID_NODE)
+			world[node] = localMatrix(node);
+		else
+			world[node] = world[p] * localMatrix(node);
+	}
+
+	// counting sort of the nodes by depth
+	void buildLevels()
+	{
+		uint32_t maxDepth = 0;
+		for (uint32_t d : depth)
+			maxDepth = std::max(maxDepth, d);
+
+		m_LevelStart.assign(maxDepth + 2, 0);
+		for (uint32_t d : depth)
+			m_LevelStart[d + 1]++;
+		for (size_t level = 1; level < m_LevelStart.size(); level++)
+			m_LevelStart[level] += m_LevelStart[level - 1];
+
+		m_LevelOrder.resize(parent.size());
+		std::vector<size_t> cursor(m_LevelStart.begin(), m_LevelStart.end() - 1);
+		for (size_t i = 0; i < parent.size(); i++)
+			m_LevelOrder[cursor[depth[i]]++] = static_cast<NodeId>(i);
+
+		m_LevelsDirty = false;
+	}
+
+	std::vector<NodeId> m_LevelOrder;
+	std::vector<size_t> m_LevelStart;
+	bool m_LevelsDirty = true;
+};
+#endif
@@ -0,0 +1,61 @@
+#version 430 core
+
+// Frustum culling for GpuDrivenScene (gpu_driven.h): one invocation per instance. Visible instances are
+// appended to their mesh's range of the visible list and counted into the mesh's indirect command.
+layout(local_size_x = 64) in;
+
+struct Instance
+{
+    mat4 model;
+    uint mesh;
+};
+
+struct MeshBounds
+{
+    vec4 center;   // object space, w unused
+    vec4 extents;
+    uint command;  // index of the mesh's DrawElementsIndirectCommand
+};
+
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance; // start of the mesh's range in visibleInstances
+};
+
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 1) readonly buffer Meshes { MeshBounds meshes[]; };
+layout(std430, binding = 2) buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 3) writeonly buffer VisibleInstances { uint visibleInstances[]; };
+
+uniform vec4 frustumPlanes[6];
+uniform uint instanceCount;
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= instanceCount)
+        return;
+
+    Instance instance = instances[id];
+    MeshBounds bounds = meshes[instance.mesh];
+
+    // world AABB of the transformed local box
+    vec3 center = vec3(instance.model * vec4(bounds.center.xyz, 1.0f));
+    vec3 extents = abs(instance.model[0].xyz) * bounds.extents.x +
+                   abs(instance.model[1].xyz) * bounds.extents.y +
+                   abs(instance.model[2].xyz) * bounds.extents.z;
+
+    for (int i = 0; i < 6; i++)
+    {
+        vec4 plane = frustumPlanes[i];
+        if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extents) < 0.0f)
+            return;
+    }
+
+    uint slot = atomicAdd(commands[bounds.command].instanceCount, 1u);
+    visibleInstances[commands[bounds.command].baseInstance + slot] = id;
+}
@@ -0,0 +1,51 @@
+#version 430 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 tex;
+layout(location = 3) in vec3 tangent;
+layout(location = 4) in vec3 bitangent;
+layout(location = 5) in ivec4 boneIds; 
+layout(location = 6) in vec4 weights;
+// index into the instance buffer, read from the visible list written by gpu_cull.cs
+layout(location = 7) in uint instanceId;
+
+struct Instance
+{
+    mat4 model;
+    uint mesh;
+};
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+
+uniform mat4 projection;
+uniform mat4 view;
+
+const int MAX_BONES = 100;
+const int MAX_BONE_INFLUENCE = 4;
+uniform mat4 finalBonesMatrices[MAX_BONES];
+
+out vec2 TexCoords;
+
+void main()
+{
+    vec4 totalPosition = vec4(0.0f);
+    for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
+    {
+        if(boneIds[i] == -1) 
+            continue;
+        if(boneIds[i] >=MAX_BONES) 
+        {
+            totalPosition = vec4(pos,1.0f);
+            break;
+        }
+        vec4 localPosition = finalBonesMatrices[boneIds[i]] * vec4(pos,1.0f);
+        totalPosition += localPosition * weights[i];
+   }
+    // unskinned vertices keep their bind pose
+    if(boneIds[0] == -1)
+        totalPosition = vec4(pos,1.0f);
+	
+    mat4 viewModel = view * instances[instanceId].model;
+    gl_Position =  projection * viewModel * totalPosition;
+	TexCoords = tex;
+}
@@ -0,0 +1,49 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 FrameUV0;
+in vec2 FrameUV1;
+in vec2 FrameUV2;
+in vec3 FrameWeights;
+in vec3 WorldPosition;
+in vec3 ToCamera;
+in float Radius;
+in mat3 LocalToWorld;
+
+uniform sampler2D impostorAlbedo;
+uniform sampler2D impostorNormal;
+uniform sampler2D impostorDepth;
+uniform mat4 projection;
+uniform mat4 view;
+// 0 keeps the unlit look of anim_model.fs
+uniform float lighting;
+uniform vec3 lightDirection;
+
+void main()
+{
+    vec4 albedo0 = texture(impostorAlbedo, FrameUV0);
+    vec4 albedo1 = texture(impostorAlbedo, FrameUV1);
+    vec4 albedo2 = texture(impostorAlbedo, FrameUV2);
+    vec4 albedo = albedo0 * FrameWeights.x + albedo1 * FrameWeights.y + albedo2 * FrameWeights.z;
+    if(albedo.a < 0.5f)
+        discard;
+    // frames that are empty at this texel don't get a say in normal and depth
+    vec3 weights = FrameWeights * vec3(albedo0.a, albedo1.a, albedo2.a);
+    weights /= weights.x + weights.y + weights.z;
+    albedo.rgb /= albedo.a;
+
+    vec3 normal = (texture(impostorNormal, FrameUV0).xyz * weights.x +
+                   texture(impostorNormal, FrameUV1).xyz * weights.y +
+                   texture(impostorNormal, FrameUV2).xyz * weights.z) * 2.0f - 1.0f;
+    normal = normalize(LocalToWorld * normal);
+    float diffuse = max(dot(normal, -normalize(lightDirection)), 0.0f) * 0.8f + 0.2f;
+    FragColor = vec4(albedo.rgb * mix(1.0f, diffuse, lighting), 1.0f);
+
+    // baked depth is 0 at 2 radii in front of the center and 1 at 2 radii behind it
+    float depth = texture(impostorDepth, FrameUV0).r * weights.x +
+                  texture(impostorDepth, FrameUV1).r * weights.y +
+                  texture(impostorDepth, FrameUV2).r * weights.z;
+    vec3 surface = WorldPosition + ToCamera * (2.0f - 4.0f * depth) * Radius;
+    vec4 clip = projection * view * vec4(surface, 1.0f);
+    gl_FragDepth = clip.z / clip.w * 0.5f + 0.5f;
+}
@@ -0,0 +1,98 @@
+#version 330 core
+
+// camera-facing quad per instance; the three nearest octahedral frames of the atlas are projected onto it
+layout(location = 0) in vec2 corner;
+// per-instance model matrix of the entity (locations 1-4)
+layout(location = 1) in mat4 instanceModel;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec3 cameraPosition;
+uniform vec3 boundsCenter;
+uniform float boundsRadius;
+uniform float framesPerSide;
+
+out vec2 FrameUV0;
+out vec2 FrameUV1;
+out vec2 FrameUV2;
+out vec3 FrameWeights;
+out vec3 WorldPosition;
+out vec3 ToCamera;
+out float Radius;
+out mat3 LocalToWorld;
+
+// octahedral mapping of a unit direction to [-1, 1]^2, inverse of octDecode and ImpostorBaker::frameDirection (impostor.h)
+vec2 octEncode(vec3 d)
+{
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    vec2 e = d.xz;
+    if(d.y < 0.0f)
+        e = (1.0f - abs(d.zx)) * vec2(d.x >= 0.0f ? 1.0f : -1.0f, d.z >= 0.0f ? 1.0f : -1.0f);
+    return e;
+}
+
+vec3 octDecode(vec2 e)
+{
+    vec3 d = vec3(e.x, 1.0f - abs(e.x) - abs(e.y), e.y);
+    if(d.y < 0.0f)
+        d.xz = (1.0f - abs(d.zx)) * vec2(d.x >= 0.0f ? 1.0f : -1.0f, d.z >= 0.0f ? 1.0f : -1.0f);
+    return normalize(d);
+}
+
+// same basis as the bake camera of that frame
+void frameBasis(vec3 d, out vec3 right, out vec3 up)
+{
+    vec3 worldUp = abs(d.y) > 0.999f ? vec3(0.0f, 0.0f, 1.0f) : vec3(0.0f, 1.0f, 0.0f);
+    right = normalize(cross(worldUp, d));
+    up = cross(d, right);
+}
+
+vec2 frameUV(vec2 frame, vec3 localOffset)
+{
+    vec3 right, up;
+    frameBasis(octDecode(frame / (framesPerSide - 1.0f) * 2.0f - 1.0f), right, up);
+    vec2 uv = vec2(dot(localOffset, right), dot(localOffset, up)) * 0.5f + 0.5f;
+    return (frame + uv) / framesPerSide;
+}
+
+void main()
+{
+    float scale = length(instanceModel[0].xyz);
+    vec3 center = vec3(instanceModel * vec4(boundsCenter, 1.0f));
+    float radius = boundsRadius * scale;
+    vec3 toCamera = normalize(cameraPosition - center);
+
+    vec3 right, up;
+    frameBasis(toCamera, right, up);
+    vec3 worldPosition = center + (right * corner.x + up * corner.y) * radius;
+    gl_Position = projection * view * vec4(worldPosition, 1.0f);
+
+    // view direction and quad corner in the entity's space (rotation and uniform scale)
+    mat3 rotation = mat3(instanceModel) / scale;
+    vec3 localDirection = transpose(rotation) * toCamera;
+    vec3 localOffset = transpose(rotation) * (worldPosition - center) / radius;
+
+    // blend the three frames of the grid triangle around the view direction
+    vec2 grid = (octEncode(localDirection) * 0.5f + 0.5f) * (framesPerSide - 1.0f);
+    vec2 base = min(floor(grid), vec2(framesPerSide - 2.0f));
+    vec2 f = grid - base;
+    if(f.x + f.y < 1.0f)
+    {
+        FrameUV0 = frameUV(base, localOffset);
+        FrameUV1 = frameUV(base + vec2(1.0f, 0.0f), localOffset);
+        FrameUV2 = frameUV(base + vec2(0.0f, 1.0f), localOffset);
+        FrameWeights = vec3(1.0f - f.x - f.y, f.x, f.y);
+    }
+    else
+    {
+        FrameUV0 = frameUV(base + vec2(1.0f, 1.0f), localOffset);
+        FrameUV1 = frameUV(base + vec2(1.0f, 0.0f), localOffset);
+        FrameUV2 = frameUV(base + vec2(0.0f, 1.0f), localOffset);
+        FrameWeights = vec3(f.x + f.y - 1.0f, 1.0f - f.y, 1.0f - f.x);
+    }
+
+    WorldPosition = worldPosition;
+    ToCamera = toCamera;
+    Radius = radius;
+    LocalToWorld = rotation;
+}
@@ -0,0 +1,18 @@
+#version 330 core
+layout(location = 0) out vec4 Albedo;
+layout(location = 1) out vec4 NormalOut;
+
+in vec2 TexCoords;
+in vec3 Normal;
+
+uniform sampler2D texture_diffuse1;
+
+void main()
+{    
+    vec4 albedo = texture(texture_diffuse1, TexCoords);
+    if(albedo.a < 0.5f)
+        discard;
+    Albedo = vec4(albedo.rgb, 1.0f);
+    // model-space normal packed to [0, 1]
+    NormalOut = vec4(normalize(Normal) * 0.5f + 0.5f, 1.0f);
+}
@@ -1,6 +1,7 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 #include <learnopengl/animator.h>
+#include <learnopengl/asset_manager.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/filesystem.h>
 #include <learnopengl/model_animation.h>
@@ -83,25 +84,34 @@ int main() {
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
 
-    // build and compile shaders
+    // load shaders and models in the background: the handles come back at
+    // once and the render loop starts drawing each asset when it's ready.
+    // Higher priorities load first.
     // -------------------------
-    Shader ourShader("anim_model.vs", "anim_model.fs");
-
-    // load models
-    // -----------
-    Model ourModel(FileSystem::getPath("resources/objects/maria/Idle.dae"));
-    Animation idleAnimation(
-        FileSystem::getPath("resources/objects/maria/Idle.dae"), &ourModel);
-    Animation walkAnimation(
-        FileSystem::getPath("resources/objects/maria/Walking.dae"), &ourModel);
-    Animation runAnimation(
-        FileSystem::getPath("resources/objects/maria/Fast Run.dae"), &ourModel);
-    // Animation
-    // stepAnimation(FileSystem::getPath("resources/objects/wiz/step-mixamo/Standing
-    // Dodge Backward.dae"), &ourModel);
-    Animation jumpAnimation(
-        FileSystem::getPath("resources/objects/maria/Jump.dae"), &ourModel);
-    Animator animator(&idleAnimation);
+    AssetManager assets;
+    AssetHandle<Shader> ourShader =
+        assets.loadShader("anim_model.vs", "anim_model.fs", 100);
+    AssetHandle<Model> ourModel = assets.loadModel(
+        FileSystem::getPath("resources/objects/maria/Idle.dae"), 50);
+
+    // animation clips load the first time they're played and are dropped
+    // again when unused clips go over the budget
+    // -------------------------
+    AnimationStreamer clips(4 * 1024 * 1024);
+    const unsigned int idleAnimation =
+        clips.add(FileSystem::getPath("resources/objects/maria/Idle.dae"));
+    const unsigned int walkAnimation =
+        clips.add(FileSystem::getPath("resources/objects/maria/Walking.dae"));
+    const unsigned int runAnimation =
+        clips.add(FileSystem::getPath("resources/objects/maria/Fast Run.dae"));
+    // const unsigned int stepAnimation =
+    // clips.add(FileSystem::getPath("resources/objects/wiz/step-mixamo/Standing
+    // Dodge Backward.dae"));
+    const unsigned int jumpAnimation =
+        clips.add(FileSystem::getPath("resources/objects/maria/Jump.dae"));
+    Animator animator(nullptr);
+    // the pose holds until the clip is in
+    animator.PlayAnimation(clips, idleAnimation);
 
     // draw in wireframe
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -115,30 +125,37 @@ int main() {
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // create the GL objects of assets that finished loading, a couple of
+        // milliseconds per frame, and bind loaded clips once the model is in
+        // -----
+        assets.update();
+        clips.setModel(ourModel.get());
+        clips.update();
+
         // input
         // -----
         processInput(window);
         // direct number key shortcuts (primary mappings)
         if (glfwGetKey(window, KEY_ACTION_IDLE) == GLFW_PRESS)
-            animator.PlayAnimation(&idleAnimation);
+            animator.PlayAnimation(clips, idleAnimation);
         if (glfwGetKey(window, KEY_ACTION_WALK) == GLFW_PRESS)
-            animator.PlayAnimation(&walkAnimation);
+            animator.PlayAnimation(clips, walkAnimation);
         if (glfwGetKey(window, KEY_ACTION_RUN) == GLFW_PRESS)
-            animator.PlayAnimation(&runAnimation);
+            animator.PlayAnimation(clips, runAnimation);
         if (glfwGetKey(window, KEY_ACTION_JUMP) == GLFW_PRESS)
-            animator.PlayAnimation(&jumpAnimation);
+            animator.PlayAnimation(clips, jumpAnimation);
 
         // simple single-animation controls (the provided Animator has a minimal
         // API)
         // alternative keys (kept for convenience)
         if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-            animator.PlayAnimation(&walkAnimation);  // E => walk (alt)
+            animator.PlayAnimation(clips, walkAnimation);  // E => walk (alt)
         if (glfwGetKey(window, KEY_ACTION_JUMP) == GLFW_PRESS)
             animator.PlayAnimation(
-                &jumpAnimation);  // Space => jump (same as KEY_ACTION_JUMP)
+                clips, jumpAnimation);  // Space => jump (same as KEY_ACTION_JUMP)
         if (glfwGetKey(window, KEY_ACTION_RUN) == GLFW_PRESS)
             animator.PlayAnimation(
-                &runAnimation);  // R => run (same as KEY_ACTION_RUN)
+                clips, runAnimation);  // R => run (same as KEY_ACTION_RUN)
 
         animator.UpdateAnimation(deltaTime);
 
@@ -147,9 +164,6 @@ int main() {
         glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // don't forget to enable shader before setting uniforms
-        ourShader.use();
-
         // Debug: print active key mapping once
         static bool printedMappings = false;
         if (!printedMappings) {
@@ -160,31 +174,40 @@ int main() {
             printedMappings = true;
         }
 
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(
-            glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT,
-            0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        auto transforms = animator.GetFinalBoneMatrices();
-        for (int i = 0; i < transforms.size(); ++i)
-            ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]",
-                              transforms[i]);
-
-        // render the loaded model
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(
-            model, characterPosition);  // translate it down so it's at the
-                                        // center of the scene
-        model = glm::scale(
-            model,
-            glm::vec3(
-                .75f, .75f,
-                .75f));  // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        ourModel.Draw(ourShader);
+        // the character appears once its shader and model have loaded
+        Shader* shader = ourShader.get();
+        Model* character = ourModel.get();
+        if (shader && character) {
+            // don't forget to enable shader before setting uniforms
+            shader->use();
+
+            // view/projection transformations
+            glm::mat4 projection = glm::perspective(
+                glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT,
+                0.1f, 100.0f);
+            glm::mat4 view = camera.GetViewMatrix();
+            shader->setMat4("projection", projection);
+            shader->setMat4("view", view);
+
+            auto transforms = animator.GetFinalBoneMatrices();
+            for (int i = 0; i < transforms.size(); ++i)
+                shader->setMat4(
+                    "finalBonesMatrices[" + std::to_string(i) + "]",
+                    transforms[i]);
+
+            // render the loaded model
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(
+                model, characterPosition);  // translate it down so it's at the
+                                            // center of the scene
+            model = glm::scale(
+                model,
+                glm::vec3(.75f, .75f,
+                          .75f));  // it's a bit too big for our scene, so scale
+                                   // it down
+            shader->setMat4("model", model);
+            character->Draw(*shader);
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse
         // moved etc.)
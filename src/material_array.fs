@@ -0,0 +1,38 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+flat in int Material;
+
+// MAX_TEXTURE_ARRAYS in texture_array.h
+uniform sampler2DArray textureArrays[8];
+// one texel per material: diffuse, specular, normal, height layers (array << 16 | layer, -1 for none)
+uniform isamplerBuffer materials;
+
+// GLSL 3.30 only indexes sampler arrays with constants, hence the switch; the gradients come from outside it
+// because neighbouring pixels may take different branches
+vec4 sampleLayer(int packedLayer, vec2 uv, vec2 dx, vec2 dy)
+{
+    vec3 coord = vec3(uv, float(packedLayer & 0xFFFF));
+    switch(packedLayer >> 16)
+    {
+    case 0: return textureGrad(textureArrays[0], coord, dx, dy);
+    case 1: return textureGrad(textureArrays[1], coord, dx, dy);
+    case 2: return textureGrad(textureArrays[2], coord, dx, dy);
+    case 3: return textureGrad(textureArrays[3], coord, dx, dy);
+    case 4: return textureGrad(textureArrays[4], coord, dx, dy);
+    case 5: return textureGrad(textureArrays[5], coord, dx, dy);
+    case 6: return textureGrad(textureArrays[6], coord, dx, dy);
+    case 7: return textureGrad(textureArrays[7], coord, dx, dy);
+    }
+    return vec4(1.0f);
+}
+
+void main()
+{
+    vec2 dx = dFdx(TexCoords);
+    vec2 dy = dFdy(TexCoords);
+    int diffuse = texelFetch(materials, Material).x;
+    // like an unbound texture_diffuse1 in anim_model.fs
+    FragColor = diffuse < 0 ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : sampleLayer(diffuse, TexCoords, dx, dy);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+
+// static geometry whose textures live in a TextureArrayPool, see texture_array.h
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 tex;
+// index into the MaterialTable, per vertex so meshes with different textures share a draw
+layout(location = 7) in int materialIndex;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+
+out vec2 TexCoords;
+flat out int Material;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(pos, 1.0f);
+	TexCoords = tex;
+    Material = materialIndex;
+}
@@ -0,0 +1,8 @@
+#version 330 core
+out vec4 FragColor;
+
+// color writes are masked off while queries run, only the samples count
+void main()
+{
+    FragColor = vec4(1.0f);
+}
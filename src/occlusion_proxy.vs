@@ -0,0 +1,13 @@
+#version 330 core
+
+// unit cube scaled to an entity's world AABB (see gpu_occlusion.h)
+layout(location = 0) in vec3 pos;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(pos, 1.0f);
+}